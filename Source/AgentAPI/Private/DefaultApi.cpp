@@ -649,6 +649,171 @@ THTTPResult<TVariant<TMap<FString, TSharedPtr<WorkspaceConfiguration>>>> Default
 
 
 
+THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>> DefaultApi::GetWorkspaceEvents(FString repoID, FString workspaceID, TOptional<int64> cursor, TOptional<int32> waitSeconds, 
+        const FString& Token,
+        const TMap<FString, FString>& Headers,
+		int ConnectionTimeoutSeconds, int RequestTimeoutSeconds) const
+{
+
+    FString URL = TEXT("/repo/{RepoID}/workspace/{WorkspaceID}/events");
+    URL.ReplaceInline(TEXT("{RepoID}"), *DiversionHttp::URLEncode(DiversionHttp::parameterToString(repoID)));
+    URL.ReplaceInline(TEXT("{WorkspaceID}"), *DiversionHttp::URLEncode(DiversionHttp::parameterToString(workspaceID)));
+
+    TMap<FString, FString> localVarQueryParams;
+    TMap<FString, FString> localVarFormParams;
+    //TMap<FString, TSharedPtr<HttpContent>> localVarFileParams;
+
+    
+    TSet<FString> localVarResponseHttpContentTypes;
+    localVarResponseHttpContentTypes.Add(TEXT("application/json"));
+
+    FString localVarResponseHttpContentType;
+
+    // use JSON if possible
+    if (localVarResponseHttpContentTypes.Num() == 0)
+    {
+        localVarResponseHttpContentType = TEXT("application/json");
+    }
+    // JSON
+    else if (localVarResponseHttpContentTypes.Contains(TEXT("application/json")))
+    {
+        localVarResponseHttpContentType = TEXT("application/json");
+    }
+    else
+    {
+        return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(TEXT("DefaultApi->GetWorkspaceEvents does not produce any supported media type"), 400, {});
+    }
+
+    // TODO: Add this to the headers
+    //Headers[TEXT("Accept")] = localVarResponseHttpContentType;
+
+    TSet<FString> localVarConsumeHttpContentTypes;
+
+    if (cursor.IsSet())
+    {
+        localVarQueryParams.Add(TEXT("Cursor"), DiversionHttp::URLEncode(DiversionHttp::parameterToString(cursor.GetValue())));
+    }
+    if (waitSeconds.IsSet())
+    {
+        localVarQueryParams.Add(TEXT("WaitSeconds"), DiversionHttp::URLEncode(DiversionHttp::parameterToString(waitSeconds.GetValue())));
+    }
+
+    FString Content = TEXT("");
+    // TSharedPtr<IHttpBody> localVarHttpBody;
+    FString localVarRequestHttpContentType;
+
+    // use JSON if possible
+    if (localVarConsumeHttpContentTypes.Num() == 0 || localVarConsumeHttpContentTypes.Contains(TEXT("application/json")))
+    {
+        localVarRequestHttpContentType = TEXT("application/json");
+    }
+    else
+    {
+        return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(TEXT("DefaultApi->GetWorkspaceEvents does not consume any supported media type"), 415, {});
+    }
+
+    // Add query params
+    if (localVarQueryParams.Num() > 0) {
+        URL += TEXT("?");
+        FString QueryParams;
+        for (const auto& Param : localVarQueryParams)
+        {
+            QueryParams += Param.Key + TEXT("=") + Param.Value + TEXT("&");
+        }
+        QueryParams.RemoveFromEnd(TEXT("&"));
+        URL += QueryParams;
+    }
+
+    DiversionHttp::HTTPCallResponse Response = ApiClient->SendRequest(URL, DiversionHttp::HttpMethod::GET, Token, localVarRequestHttpContentType, 
+        Content, Headers, ConnectionTimeoutSeconds, RequestTimeoutSeconds);
+
+    // TODO: Add validation - check response content type
+    
+    if (Response.ResponseCode == 200) {
+        if(localVarResponseHttpContentType == TEXT("application/json"))
+        {
+            TSharedPtr<WorkspaceEvents> localVarResult = MakeShared<WorkspaceEvents>();
+            TSharedPtr<FJsonValue> JsonValue;
+            TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(Response.Contents);
+            if (!FJsonSerializer::Deserialize(JsonReader, JsonValue) || !JsonValue.IsValid())
+            {
+                return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(TEXT("error calling getWorkspaceEvents: JSON reader failed parsing the response string"), 500, Response.Headers);
+            }
+
+            
+            if (localVarResult->FromJson(JsonValue)) {
+                TVariant<TSharedPtr<WorkspaceEvents>, void*> variantResult;
+                variantResult.Emplace<TSharedPtr<WorkspaceEvents>>(localVarResult);
+                return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Success(TOptional(variantResult), Response.ResponseCode, Response.Headers);
+            }
+            else {
+                return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(TEXT("error calling getWorkspaceEvents: JSON response was not in the expected format"), 500, Response.Headers);
+            }
+        }
+
+
+        else
+        {
+            return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(TEXT("error calling getWorkspaceEvents: unsupported response type"), 500, Response.Headers);
+        }
+    }
+    if (Response.ResponseCode == 410) {
+            FString ErrorMessage = TEXT("General Failure");
+            if(Response.Error.IsSet()) {
+                ErrorMessage = Response.Error.GetValue();
+            } 
+            FString CurrError = TEXT("error calling getWorkspaceEvents: ") + ErrorMessage;
+            return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(CurrError, Response.ResponseCode, Response.Headers);
+
+    }
+    if (Response.ResponseCode == 412) {
+            FString ErrorMessage = TEXT("General Failure");
+            if(Response.Error.IsSet()) {
+                ErrorMessage = Response.Error.GetValue();
+            } 
+            FString CurrError = TEXT("error calling getWorkspaceEvents: ") + ErrorMessage;
+            return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(CurrError, Response.ResponseCode, Response.Headers);
+
+    }
+
+
+    if (Response.ResponseCode >= 400)
+    {
+            FString ErrorMessage = TEXT("General Failure");
+            if(Response.Error.IsSet()) {
+                ErrorMessage = Response.Error.GetValue();
+            } 
+            else if(!Response.Contents.IsEmpty()) {
+                // Try parsing as JSON
+                TSharedPtr<FJsonObject> JsonObject;
+                TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(Response.Contents);
+                if (FJsonSerializer::Deserialize(JsonReader, JsonObject) 
+                    && JsonObject.IsValid())
+                {
+                    if (JsonObject->HasField(TEXT("error_message"))) {
+                        ErrorMessage = JsonObject->GetStringField(TEXT("error_message"));
+                    }
+                    else {
+                        // Treat it as an error string 
+                        ErrorMessage = Response.Contents;
+                    }
+                }
+                else {
+                    // Treat it as an error string 
+                    ErrorMessage = Response.Contents;
+                }
+            }
+
+            FString CurrError = TEXT("error calling getWorkspaceEvents: ") + ErrorMessage;
+            return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(CurrError, Response.ResponseCode, Response.Headers);
+    }
+
+    // Unepxected response code - TODO: try parse as any of the expected response types
+    return THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>>::Failure(TEXT("error calling GetWorkspaceEvents: unexpected response code"), Response.ResponseCode, Response.Headers);
+}
+
+
+
 THTTPResult<TVariant<TSharedPtr<WorkspaceSyncStatus>>> DefaultApi::GetWorkspaceSyncStatus(FString repoID, FString workspaceID, 
         const FString& Token,
         const TMap<FString, FString>& Headers,
@@ -0,0 +1,106 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+/**
+ * Agent API
+ * API of Diversion sync agent
+ *
+ * The version of the OpenAPI document: 1.0
+ *
+ * NOTE: This class is auto generated by OpenAPI-Generator 7.10.0.
+ * https://openapi-generator.tech
+ * Do not edit the class manually.
+ */
+
+
+
+#include "JsonBody.h"
+#include "WorkspaceEvent.h"
+
+namespace Diversion {
+namespace AgentAPI {
+namespace Model {
+
+
+
+void WorkspaceEvent::WriteJson(JsonWriter& Writer) const
+{
+	Writer->WriteObjectStart();
+	Writer->WriteIdentifierPrefix(TEXT("Type")); WriteJsonValue(Writer, WorkspaceEvent::EnumToString(mType));
+	if (mPaths.IsSet())
+	{
+		Writer->WriteIdentifierPrefix(TEXT("Paths")); WriteJsonValue(Writer, mPaths.GetValue());
+	}
+	if (mIsSyncComplete.IsSet())
+	{
+		Writer->WriteIdentifierPrefix(TEXT("IsSyncComplete")); WriteJsonValue(Writer, mIsSyncComplete.GetValue());
+	}
+	if (mIsPaused.IsSet())
+	{
+		Writer->WriteIdentifierPrefix(TEXT("IsPaused")); WriteJsonValue(Writer, mIsPaused.GetValue());
+	}
+	Writer->WriteObjectEnd();
+}
+
+bool WorkspaceEvent::FromJson(const TSharedPtr<FJsonValue>& JsonValue)
+{
+
+	const TSharedPtr<FJsonObject>* InnerGeneratorOpenAPIObject;
+	if (!JsonValue->TryGetObject(InnerGeneratorOpenAPIObject))
+		return false;
+
+	bool ParseSuccess = true;
+
+    
+
+    // Reading the value into a string enum first
+    FString TypeString;
+    bool ParseEnumTypeStringSuccess = TryGetJsonValue(*InnerGeneratorOpenAPIObject, TEXT("Type"), TypeString);
+    if (ParseEnumTypeStringSuccess) {
+        ParseSuccess &= WorkspaceEvent::EnumFromString(TypeString, mType);
+        
+    }
+    ParseSuccess &= TryGetJsonValue(*InnerGeneratorOpenAPIObject, TEXT("Paths"), mPaths);
+    ParseSuccess &= TryGetJsonValue(*InnerGeneratorOpenAPIObject, TEXT("IsSyncComplete"), mIsSyncComplete);
+    ParseSuccess &= TryGetJsonValue(*InnerGeneratorOpenAPIObject, TEXT("IsPaused"), mIsPaused);
+
+
+	return ParseSuccess;
+}
+
+
+FString WorkspaceEvent::EnumToString(const TypeEnum& EnumValue) {
+    switch (EnumValue)
+    {
+    case TypeEnum::FILES_CHANGED:
+        return TEXT("FILES_CHANGED");
+    case TypeEnum::SYNC_PROGRESS:
+        return TEXT("SYNC_PROGRESS");
+    case TypeEnum::WORKSPACE_SWITCHED:
+        return TEXT("WORKSPACE_SWITCHED");
+    default:
+        return TEXT("");
+    }
+}
+
+bool WorkspaceEvent::EnumFromString(const FString& EnumAsString, TypeEnum& EnumValue) {
+    if(EnumAsString.IsEmpty()) return false;
+    if(EnumAsString == TEXT("FILES_CHANGED")) {
+        EnumValue = TypeEnum::FILES_CHANGED;
+        return true;
+    }
+    if(EnumAsString == TEXT("SYNC_PROGRESS")) {
+        EnumValue = TypeEnum::SYNC_PROGRESS;
+        return true;
+    }
+    if(EnumAsString == TEXT("WORKSPACE_SWITCHED")) {
+        EnumValue = TypeEnum::WORKSPACE_SWITCHED;
+        return true;
+    }
+
+    return false;
+}
+
+
+}
+}
+}
+
@@ -0,0 +1,54 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+/**
+ * Agent API
+ * API of Diversion sync agent
+ *
+ * The version of the OpenAPI document: 1.0
+ *
+ * NOTE: This class is auto generated by OpenAPI-Generator 7.10.0.
+ * https://openapi-generator.tech
+ * Do not edit the class manually.
+ */
+
+
+
+#include "JsonBody.h"
+#include "WorkspaceEvents.h"
+
+namespace Diversion {
+namespace AgentAPI {
+namespace Model {
+
+
+
+void WorkspaceEvents::WriteJson(JsonWriter& Writer) const
+{
+	Writer->WriteObjectStart();
+	Writer->WriteIdentifierPrefix(TEXT("Cursor")); WriteJsonValue(Writer, mCursor);
+	Writer->WriteIdentifierPrefix(TEXT("Events")); WriteJsonValue(Writer, mEvents);
+	Writer->WriteObjectEnd();
+}
+
+bool WorkspaceEvents::FromJson(const TSharedPtr<FJsonValue>& JsonValue)
+{
+
+	const TSharedPtr<FJsonObject>* InnerGeneratorOpenAPIObject;
+	if (!JsonValue->TryGetObject(InnerGeneratorOpenAPIObject))
+		return false;
+
+	bool ParseSuccess = true;
+
+    
+
+	ParseSuccess &= TryGetJsonValue(*InnerGeneratorOpenAPIObject, TEXT("Cursor"), mCursor);
+	ParseSuccess &= TryGetJsonValue(*InnerGeneratorOpenAPIObject, TEXT("Events"), mEvents);
+
+
+	return ParseSuccess;
+}
+
+
+}
+}
+}
+
@@ -24,6 +24,7 @@
 
 #include "UserErrors.h"
 #include "WorkspaceConfiguration.h"
+#include "WorkspaceEvents.h"
 #include "WorkspaceSyncProgress.h"
 #include "WorkspaceSyncStatus.h"
 #include <vector>
@@ -86,6 +87,21 @@ public:
         const TMap<FString, FString>& Headers,
 		int ConnectionTimeoutSeconds, int RequestTimeoutSeconds) const;
 
+    /**
+    * Long poll for workspace change events
+    * Returns as soon as there are events newer than the cursor, or with no events once WaitSeconds elapsed.
+    * @param repoID @param workspaceID @param cursor Cursor returned by the previous call. Omit to subscribe from now on. @param waitSeconds Max time to hold the request open while there are no new events 
+    * @return 
+    */
+    THTTPResult<TVariant<TSharedPtr<WorkspaceEvents>, void*>> GetWorkspaceEvents(
+        FString repoID,
+        FString workspaceID,
+        TOptional<int64> cursor,
+        TOptional<int32> waitSeconds,
+        const FString& Token,
+        const TMap<FString, FString>& Headers,
+		int ConnectionTimeoutSeconds, int RequestTimeoutSeconds) const;
+
     /**
     * Get workspace sync status
     * @param repoID @param workspaceID 
@@ -136,6 +152,7 @@ public:
     typedef FApiResponseDelegate<TVariant<TArray<TSharedPtr<FileSyncStatus>>, void*>> FgetFileSyncStatusDelegate;
     typedef FApiResponseDelegate<TVariant<TSharedPtr<WorkspaceSyncProgress>, void*>> FgetSyncProgressDelegate;
     typedef FApiResponseDelegate<TVariant<TMap<FString, TSharedPtr<WorkspaceConfiguration>>>> FgetWorkspaceByPathDelegate;
+    typedef FApiResponseDelegate<TVariant<TSharedPtr<WorkspaceEvents>, void*>> FgetWorkspaceEventsDelegate;
     typedef FApiResponseDelegate<TVariant<TSharedPtr<WorkspaceSyncStatus>>> FgetWorkspaceSyncStatusDelegate;
     typedef FApiResponseDelegate<TVariant<TSharedPtr<IsAlive_200_response>>> FisAliveDelegate;
     typedef FApiResponseDelegate<TVariant<void*>> FnotifySyncRequiredDelegate;
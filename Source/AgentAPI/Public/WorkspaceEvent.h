@@ -0,0 +1,69 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+/**
+ * Agent API
+ * API of Diversion sync agent
+ *
+ * The version of the OpenAPI document: 1.0
+ *
+ * NOTE: This class is auto generated by OpenAPI-Generator 7.10.0.
+ * https://openapi-generator.tech
+ * Do not edit the class manually.
+ */
+
+/*
+ * WorkspaceEvent.h
+ *
+ * A change in the workspace the client should react to
+ */
+#pragma once
+
+
+#include "ModelBase.h"
+#include <vector>
+
+namespace Diversion {
+namespace AgentAPI {
+namespace Model {
+
+
+/*
+ * WorkspaceEvent
+ *
+ * A change in the workspace the client should react to
+ */
+class AGENTAPI_API WorkspaceEvent
+    : public Model
+{
+public:
+    virtual ~WorkspaceEvent() {}
+
+	bool FromJson(const TSharedPtr<FJsonValue>& JsonValue) override;
+	void WriteJson(JsonWriter& Writer) const override;
+
+
+	enum class TypeEnum
+	{
+		FILES_CHANGED,
+		SYNC_PROGRESS,
+		WORKSPACE_SWITCHED,
+  	};
+
+	static FString EnumToString(const TypeEnum& EnumValue);
+	static bool EnumFromString(const FString& EnumAsString, TypeEnum& EnumValue);
+	TypeEnum mType;
+
+	/* Relative paths of the changed files (FILES_CHANGED) */
+	TOptional<TArray<FString>> mPaths;
+
+	/* Sync state after the change (SYNC_PROGRESS) */
+	TOptional<bool> mIsSyncComplete;
+
+	TOptional<bool> mIsPaused;
+
+};
+
+
+}
+}
+}
+
@@ -0,0 +1,57 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+/**
+ * Agent API
+ * API of Diversion sync agent
+ *
+ * The version of the OpenAPI document: 1.0
+ *
+ * NOTE: This class is auto generated by OpenAPI-Generator 7.10.0.
+ * https://openapi-generator.tech
+ * Do not edit the class manually.
+ */
+
+/*
+ * WorkspaceEvents.h
+ *
+ * 
+ */
+#pragma once
+
+
+#include "ModelBase.h"
+#include "WorkspaceEvent.h"
+#include <vector>
+
+namespace Diversion {
+namespace AgentAPI {
+namespace Model {
+
+class WorkspaceEvent;
+
+/*
+ * WorkspaceEvents
+ *
+ * 
+ */
+class AGENTAPI_API WorkspaceEvents
+    : public Model
+{
+public:
+    virtual ~WorkspaceEvents() {}
+
+	bool FromJson(const TSharedPtr<FJsonValue>& JsonValue) override;
+	void WriteJson(JsonWriter& Writer) const override;
+
+
+	/* Pass to the next call to get the events following these */
+	int64_t mCursor = 0L;
+
+	TArray<WorkspaceEvent> mEvents;
+
+};
+
+
+}
+}
+}
+
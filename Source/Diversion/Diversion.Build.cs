@@ -23,6 +23,7 @@ public class Diversion : ModuleRules
                 "CoreUObject",
                 "Engine",
                 "Json",
+                "AssetRegistry",
                 // Diversion dependencies
                 "Common",
                 "DiversionHttp",
@@ -38,6 +39,8 @@ public class Diversion : ModuleRules
         {
 	        PrivateIncludePaths.Add("Diversion/Tests");
 	        PrivateDependencyModuleNames.Add("UnrealEd");
+	        // Stand-in agent of the agent events tests
+	        PrivateDependencyModuleNames.Add("HTTPServer");
         }
     }
 }
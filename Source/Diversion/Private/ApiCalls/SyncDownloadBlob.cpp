@@ -3,91 +3,163 @@
 #include "DiversionUtils.h"
 #include "DiversionCommand.h"
 #include "DiversionModule.h"
+#include "HTTPResult.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
 
 
-using namespace Diversion::CoreAPI;
+namespace
+{
+	/** The path of the downloaded file on success */
+	using FDownloadResult = THTTPResult<FString>;
 
+	/** The error_message of a JSON error body, or the body itself - as the generated client reports the errors */
+	FString ParseErrorContents(const FString& InContents)
+	{
+		TSharedPtr<FJsonObject> JsonObject;
+		TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(InContents);
+		if (FJsonSerializer::Deserialize(JsonReader, JsonObject) && JsonObject.IsValid() && JsonObject->HasField(TEXT("error_message")))
+		{
+			return JsonObject->GetStringField(TEXT("error_message"));
+		}
+		return InContents;
+	}
 
-bool DiversionUtils::DownloadBlob(TArray<FString>& OutInfoMessages,
-	TArray<FString>& OutErrorMessages, const FString& InRefId, const FString& InOutputFilePath, 
-	const FString& InFilePath, WorkspaceInfo InWsInfo)
-{
-	FString RedirectUrl = "";
-	auto ErrorResponse = RepositoryManipulationApi::Fsrc_handlersv2_files_getBlobDelegate::Bind(
-		[&]() {
-			return false;
+	/**
+	 * Streams a file to InOutputFilePath. The response maps to a result like the generated GetBlob call does,
+	 * so the errors are handled through HandleApiResponse like the ones of the other API calls.
+	 */
+	FDownloadResult DownloadToFile(const DiversionHttp::FHttpRequestManager& InRequestManager, const FString& InOutputFilePath, const FString& InRequestPath,
+		const FString& InToken)
+	{
+		// The file responses are decompressed while streamed to disk, only gzip is supported there
+		const TMap<FString, FString> Headers = { {TEXT("Accept-Encoding"), TEXT("gzip")} };
+		const DiversionHttp::HTTPCallResponse Response = InRequestManager.DownloadFileFromUrl(InOutputFilePath, InRequestPath, InToken, Headers, 5, 120);
+		if (Response.ResponseCode == 200 || Response.ResponseCode == 204)
+		{
+			return FDownloadResult::Success(InOutputFilePath, Response.ResponseCode, Response.Headers);
 		}
-	);
 
-	auto VariantResponse = RepositoryManipulationApi::Fsrc_handlersv2_files_getBlobDelegate::Bind(
-		[&](const TVariant<TSharedPtr<HttpContent>, void*>& Variant, int StatusCode, TMap<FString, FString> Headers) {
-			switch (StatusCode) {
-				case 200:
-				{
-					// File was downloaded
-					if (!Variant.IsType<TSharedPtr<HttpContent>>()) {
-						// Unexpected response type
-						OutErrorMessages.Add("Unexpected response type");
-						return false;
-					}
-					// Write the file to disk
-					auto Value = Variant.Get<TSharedPtr<HttpContent>>();
-					Value->WriteToFile(InOutputFilePath);
-					OutInfoMessages.Add("File was succesfully downloaded");
-					return true;
-				}
-				case 204:
-				{
-					// No content - look for the location header for redirection URL
-					if (FString* location = Headers.Find("Location")) {
-						RedirectUrl = *location;
-						OutInfoMessages.Add("Received redirection URL for file");
-						return true;
-					}
-					return false;
-				}
-				default:
+		if (Response.ResponseCode >= 400)
+		{
+			FString ErrorMessage = TEXT("General Failure");
+			if (Response.Error.IsSet())
+			{
+				ErrorMessage = Response.Error.GetValue();
+			}
+			else
+			{
+				// The error body was streamed to the output file too
+				FString ErrorContents;
+				if (FFileHelper::LoadFileToString(ErrorContents, *InOutputFilePath) && !ErrorContents.IsEmpty())
 				{
-					// Unexpected response type
-					OutErrorMessages.Add("Unexpected response type");
-					return false;
+					ErrorMessage = ParseErrorContents(ErrorContents);
 				}
 			}
+			return FDownloadResult::Failure(FString::Printf(TEXT("error downloading file (%d): %s"), Response.ResponseCode, *ErrorMessage),
+				Response.ResponseCode, Response.Headers);
 		}
-	);
+		return FDownloadResult::Failure(FString::Printf(TEXT("error downloading file: unexpected response code %d"), Response.ResponseCode),
+			Response.ResponseCode, Response.Headers);
+	}
+}
 
-	bool Success = FDiversionModule::Get().RepositoryManipulationAPIRequestManager->SrcHandlersv2FilesGetBlob(InWsInfo.RepoID, 
-		InRefId, ConvertFullPathToRelative(InFilePath, InWsInfo.GetPath()),
-		FDiversionModule::Get().GetAccessToken(InWsInfo.AccountID), {}, 5, 120).HandleApiResponse(ErrorResponse, VariantResponse, OutErrorMessages);
 
-	if (!RedirectUrl.IsEmpty())
+bool DiversionUtils::CheckBlobFileSize(const FString& InFile, const FString& InSha, int64 InSize)
+{
+	const int64 FileSize = FPlatformFileManager::Get().GetPlatformFile().FileSize(*InFile);
+	if (FileSize < 0 || (InSize >= 0 && FileSize != InSize))
 	{
-		// If the redirect URL was populated it means we need to download the file from there
+		UE_LOG(LogSourceControl, Warning, TEXT("Blob %s has size %lld, expected %lld"), *InSha, FileSize, InSize);
+		return false;
+	}
+	return true;
+}
 
-		// Download the file from the redirect URL
-		DiversionHttp::FHttpRequestManager FileDownloaderRequestManager(RedirectUrl);
-		FString RequestPath = DiversionHttp::GetPathFromUrl(RedirectUrl);
 
-		auto Response = FileDownloaderRequestManager.DownloadFileFromUrl(InOutputFilePath, RequestPath,
-			FString(), {}, 5, 120);
-		if (Response.Error.IsSet()) {
-			OutErrorMessages.Add(Response.Error.GetValue());
-			UE_LOG(LogSourceControl, Error, TEXT("Error downloading file: %s"), *Response.Error.GetValue());
+bool DiversionUtils::DownloadBlob(TArray<FString>& OutInfoMessages,
+	TArray<FString>& OutErrorMessages, const FString& InRefId, const FString& InOutputFilePath,
+	const FString& InFilePath, WorkspaceInfo InWsInfo, const FString& InExpectedSha, int64 InExpectedSize)
+{
+	// The generated client buffers the whole blob in memory, stream it to disk through the HTTP client instead.
+	// Nothing is written under the output path until the download completed with the expected size.
+	const FString TempFilePath = FString::Printf(TEXT("%s.%s.download"), *InOutputFilePath, *FGuid::NewGuid().ToString());
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(InOutputFilePath));
+
+	FString RequestPath = TEXT("/v0/repos/{repo_id}/blobs/{ref_id}/{path}");
+	RequestPath.ReplaceInline(TEXT("{repo_id}"), *DiversionHttp::URLEncode(InWsInfo.RepoID));
+	RequestPath.ReplaceInline(TEXT("{ref_id}"), *DiversionHttp::URLEncode(InRefId));
+	RequestPath.ReplaceInline(TEXT("{path}"), *DiversionHttp::URLEncode(ConvertFullPathToRelative(InFilePath, InWsInfo.GetPath())));
+
+	FString RedirectUrl;
+	auto ErrorResponse = FDownloadResult::ArgumentDelegate();
+	auto FileResponse = FApiResponseDelegate<FString>::Bind(
+		[&](const FString& InDownloadedFile, int StatusCode, TMap<FString, FString> Headers) {
+			if (StatusCode == 200) {
+				return true;
+			}
+			// No content - look for the location header for redirection URL
+			if (const FString* Location = Headers.Find("Location")) {
+				RedirectUrl = *Location;
+				OutInfoMessages.Add("Received redirection URL for file");
+				return true;
+			}
+			OutErrorMessages.Add("Missing redirection URL for file");
 			return false;
 		}
+	);
+
+	bool bSuccess = DownloadToFile(*FDiversionModule::Get().CoreAPIClient, TempFilePath, RequestPath,
+		FDiversionModule::Get().GetAccessToken(InWsInfo.AccountID)).HandleApiResponse(ErrorResponse, FileResponse, OutErrorMessages);
 
-		if (Response.ResponseCode >= 400) {
-			OutErrorMessages.Add(Response.Contents);
-			UE_LOG(LogSourceControl, Error, TEXT("Error downloading file: %s"), *Response.Contents);
+	if (bSuccess && !RedirectUrl.IsEmpty())
+	{
+		// Download the file from the redirect URL
+		PlatformFile.DeleteFile(*TempFilePath);
+		DiversionHttp::FHttpRequestManager FileDownloaderRequestManager(RedirectUrl);
+		auto RedirectedFileResponse = FApiResponseDelegate<FString>::Bind(
+			[&](const FString& InDownloadedFile, int StatusCode) {
+				if (StatusCode != 200) {
+					OutErrorMessages.Add(FString::Printf(TEXT("Unexpected response %d downloading file from its redirection URL"), StatusCode));
+					return false;
+				}
+				return true;
+			}
+		);
+		bSuccess = DownloadToFile(FileDownloaderRequestManager, TempFilePath, DiversionHttp::GetPathFromUrl(RedirectUrl), FString())
+			.HandleApiResponse(ErrorResponse, RedirectedFileResponse, OutErrorMessages);
+	}
+
+	if (!bSuccess)
+	{
+		UE_LOG(LogSourceControl, Error, TEXT("Error downloading file %s: %s"), *InFilePath,
+			OutErrorMessages.IsEmpty() ? TEXT("") : *OutErrorMessages.Last());
+		PlatformFile.DeleteFile(*TempFilePath);
+		return false;
+	}
+
+	if (InExpectedSize >= 0)
+	{
+		if (!CheckBlobFileSize(TempFilePath, InExpectedSha, InExpectedSize)) {
+			OutErrorMessages.Add(FString::Printf(TEXT("Downloaded file %s doesn't have the expected size"), *InFilePath));
+			PlatformFile.DeleteFile(*TempFilePath);
 			return false;
 		}
+	}
 
-		if (Response.Contents.Equals(InOutputFilePath)) {
-			OutInfoMessages.Add("File was downloaded succesfully");
-			Success = true;
-		}
+	PlatformFile.DeleteFile(*InOutputFilePath);
+	if (!PlatformFile.MoveFile(*InOutputFilePath, *TempFilePath)) {
+		OutErrorMessages.Add(FString::Printf(TEXT("Failed moving the downloaded file to %s"), *InOutputFilePath));
+		PlatformFile.DeleteFile(*TempFilePath);
+		return false;
 	}
 
-	return Success;
+	OutInfoMessages.Add("File was downloaded succesfully");
+	return true;
 }
-
@@ -3,7 +3,7 @@
 #include "DiversionUtils.h"
 #include "DiversionCommand.h"
 #include "DiversionModule.h"
-#include "IDiversionStatusWorker.h"
+#include "DiversionConstants.h"
 
 
 using namespace Diversion::CoreAPI;
@@ -43,7 +43,7 @@ static void PopulateSCCRevision(TSharedRef<FDiversionRevision, ESPMode::ThreadSa
 	if (InBlob.IsSet())
 	{
 		InOutSCCRev->FileHash = InBlob.GetValue().mSha;
-		InOutSCCRev->FileSize = static_cast<int32>(InBlob.GetValue().mSize);
+		InOutSCCRev->FileSize = InBlob.GetValue().mSize;
 	}
 
 	InOutSCCRev->UserName = InUserName;
@@ -70,10 +70,10 @@ FString ExtractFileNameFromCommitEntry(const Commit& InCommitEntry)
 }
 
 
-bool DiversionUtils::RunGetHistory(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, 
-	const FString& InFile, const FString* MergeFromRef)
+/** Requests the history of a file in a ref, newest commit first */
+static bool RequestHistoryEntries(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages,
+	const FString& InRefId, const FString& InFile, TOptional<int32> InLimit, TArray<FileHistoryEntry>& OutEntries)
 {
-	
 	auto ErrorResponse = RepositoryManipulationApi::Fsrc_handlersv2_commit_getObjectHistoryDelegate::Bind([&]() {
 		return false;
 	});
@@ -93,48 +93,90 @@ bool DiversionUtils::RunGetHistory(const FDiversionCommand& InCommand, TArray<FS
 			}
 
 			auto Value = Variant.Get<TSharedPtr<Src_handlersv2_commit_get_object_history_200_response>>();
-			IDiversionStatusWorker& Worker = static_cast<IDiversionStatusWorker&>(InCommand.Worker.Get());
+			OutEntries = MoveTemp(Value->mEntries);
+			return true;
+		}
+	);
 
-			FString FilePath;
-			auto Revisions = Value->mEntries;
-			if (Revisions.Num() == 0)
-			{
-				OutInfoMessages.Add("No history found for the file");
-				return true;
-			}
+	return FDiversionModule::Get().RepositoryManipulationAPIRequestManager->SrcHandlersv2CommitGetObjectHistory(InCommand.WsInfo.RepoID,
+		InRefId, ConvertFullPathToRelative(InFile, InCommand.WsInfo.GetPath()), InLimit, TOptional<int32>(), FDiversionModule::Get().GetAccessToken(InCommand.WsInfo.AccountID), {}, 5, 120).
+		HandleApiResponse(ErrorResponse, VariantResponse, OutErrorMessages);
+}
 
-			FilePath = DiversionUtils::ConvertRelativePathToDiversionFull(Value->mEntries[0].mEntry.mPath, InCommand.WsInfo.GetPath());
 
-			TDiversionHistory History;
-			for (auto& Revision : Revisions) {
-				TSharedRef<FDiversionRevision, ESPMode::ThreadSafe> SourceControlRevision = MakeShared<FDiversionRevision>();
+/** Revisions of the history entries */
+static TDiversionHistory MakeHistory(const TArray<FileHistoryEntry>& InEntries, const WorkspaceInfo& InWsInfo)
+{
+	TDiversionHistory History;
+	History.Reserve(InEntries.Num());
+	for (const FileHistoryEntry& Revision : InEntries) {
+		TSharedRef<FDiversionRevision, ESPMode::ThreadSafe> SourceControlRevision = MakeShared<FDiversionRevision>();
 
-				FString UserName = ExtractFileNameFromCommitEntry(Revision.mCommit);
-				FString CommitMessage = Revision.mCommit.mCommit_message.IsSet() ? Revision.mCommit.mCommit_message.GetValue() : "";
+		FString UserName = ExtractFileNameFromCommitEntry(Revision.mCommit);
+		FString CommitMessage = Revision.mCommit.mCommit_message.IsSet() ? Revision.mCommit.mCommit_message.GetValue() : "";
 
-				PopulateSCCRevision(SourceControlRevision, Revision.mCommit.mCommit_id, Revision.mCommit.mCreated_ts, Revision.mEntry.mPath,
-					Revision.mEntry.mStatus, Revision.mEntry.mBlob, UserName, CommitMessage, InCommand.WsInfo);
-				History.Add(MoveTemp(SourceControlRevision));
-			}
-
-			if (TDiversionHistory* Existing = Worker.Histories.Find(FilePath)) {
-				History.Append(*Existing);
-			}
+		PopulateSCCRevision(SourceControlRevision, Revision.mCommit.mCommit_id, Revision.mCommit.mCreated_ts, Revision.mEntry.mPath,
+			Revision.mEntry.mStatus, Revision.mEntry.mBlob, UserName, CommitMessage, InWsInfo);
+		History.Add(MoveTemp(SourceControlRevision));
+	}
+	return History;
+}
 
-			Worker.Histories.Add(FilePath, MoveTemp(History));
-			return true;
-		}
-	);
 
+bool DiversionUtils::RunGetHistory(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, 
+	const FString& InFile, const FString* MergeFromRef, FString& OutFilePath, TDiversionHistory& OutHistory)
+{
+	FDiversionHistoryCache& HistoryCache = FDiversionModule::Get().GetHistoryCache();
 	FString RefId = InCommand.WsInfo.WorkspaceID;
 	TOptional<int32> Limit = TOptional<int32>();
+	TDiversionHistory CachedHistory;
 	if (MergeFromRef)
 	{
+		// The conflicting revision of another ref - a single revision, not cached
 		RefId = *MergeFromRef;
 		Limit = 1;
 	}
+	else if (HistoryCache.Find(InCommand.WsInfo, InFile, CachedHistory))
+	{
+		// Only the commits newer than the cached ones are needed
+		Limit = HISTORY_INCREMENTAL_PAGE_SIZE;
+	}
 
-	return FDiversionModule::Get().RepositoryManipulationAPIRequestManager->SrcHandlersv2CommitGetObjectHistory(InCommand.WsInfo.RepoID,
-		RefId, ConvertFullPathToRelative(InFile, InCommand.WsInfo.GetPath()), Limit, TOptional<int32>(), FDiversionModule::Get().GetAccessToken(InCommand.WsInfo.AccountID), {}, 5, 120).
-		HandleApiResponse(ErrorResponse, VariantResponse, OutErrorMessages);
+	TArray<FileHistoryEntry> Entries;
+	if (!RequestHistoryEntries(InCommand, OutInfoMessages, OutErrorMessages, RefId, InFile, Limit, Entries))
+	{
+		return false;
+	}
+
+	TDiversionHistory History = MakeHistory(Entries, InCommand.WsInfo);
+	if (!CachedHistory.IsEmpty())
+	{
+		TDiversionHistory NewestHistory = MoveTemp(History);
+		if (!FDiversionHistoryCache::MergeNewest(CachedHistory, NewestHistory, History))
+		{
+			// Either more new commits than the page holds, or the cached ones aren't part of the history anymore
+			// (e.g. the workspace switched branches) - fetch it all again
+			Entries.Reset();
+			if (!RequestHistoryEntries(InCommand, OutInfoMessages, OutErrorMessages, RefId, InFile, TOptional<int32>(), Entries))
+			{
+				return false;
+			}
+			History = MakeHistory(Entries, InCommand.WsInfo);
+		}
+	}
+
+	if (History.Num() == 0)
+	{
+		OutInfoMessages.Add("No history found for the file");
+		return true;
+	}
+
+	if (!MergeFromRef)
+	{
+		HistoryCache.Update(InCommand.WsInfo, InFile, History);
+	}
+
+	OutFilePath = DiversionUtils::ConvertRelativePathToDiversionFull(History[0]->Filename, InCommand.WsInfo.GetPath());
+	OutHistory = MoveTemp(History);
+	return true;
 }
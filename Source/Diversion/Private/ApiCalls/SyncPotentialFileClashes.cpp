@@ -4,15 +4,20 @@
 #include "DiversionUtils.h"
 #include "DiversionCommand.h"
 #include "DiversionModule.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Tasks/Task.h"
+
+#include <atomic>
 
 
 using namespace Diversion::CoreAPI;
 
+constexpr int PrefixesLimit = 20;
 
-bool DiversionUtils::GetPotentialFileClashes(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, 
-TArray<FString>& OutErrorMessages, TMap<FString, TArray<EDiversionPotentialClashInfo>>& OutPotentialClashes, bool& OutRecurseCall)
+/** Requests the potential clashes under a batch of up to PrefixesLimit relative path prefixes */
+bool RequestPotentialClashesBatch(const FDiversionCommand& InCommand, const TArray<FString>& InRelativePrefixes, bool InRecurse,
+	TArray<FString>& OutErrorMessages, TMap<FString, TArray<EDiversionPotentialClashInfo>>& OutPotentialClashes)
 {
-
 	auto ErrorResponse = RepositoryWorkspaceManipulationApi::Fsrc_handlersv2_workspace_getOtherStatusesDelegate::Bind(
 		[&]() {
 			return false;
@@ -20,7 +25,7 @@ TArray<FString>& OutErrorMessages, TMap<FString, TArray<EDiversionPotentialClash
 	);
 	auto VariantResponse = RepositoryWorkspaceManipulationApi::Fsrc_handlersv2_workspace_getOtherStatusesDelegate::Bind(
 		[&](const TVariant<TSharedPtr<RefsFilesStatus>, TSharedPtr<Diversion::CoreAPI::Model::Error>>& Variant) {
-			
+
 			if (Variant.IsType<TSharedPtr<Diversion::CoreAPI::Model::Error>>()) {
 				auto Value = Variant.Get<TSharedPtr<Diversion::CoreAPI::Model::Error>>();
 				OutErrorMessages.Add(FString::Printf(TEXT("Received error for get other statuses call: %s"), *Value->mDetail));
@@ -52,74 +57,101 @@ TArray<FString>& OutErrorMessages, TMap<FString, TArray<EDiversionPotentialClash
 				OutPotentialClashes.Add(FullStatusFilePath, PotentialClashes);
 			}
 
-			// Remove outdated potential clash data
-			for (auto& Path : InCommand.Files)
-			{
-				if (!FPaths::IsUnderDirectory(Path, WsPath))
-				{
-					UE_LOG(LogSourceControl, Log, TEXT("Path: %s is not contained in the repo, skipping."), *Path);
-					continue;
-				}
-				auto FullStatusFilePath = DiversionUtils::ConvertRelativePathToDiversionFull(Path, WsPath);
-				if (OutPotentialClashes.Contains(FullStatusFilePath)) continue;
-				// Indicate that there are no potential clashes for the file we queried
-				OutPotentialClashes.Add(FullStatusFilePath, TArray<EDiversionPotentialClashInfo>());
-			}
-
 			return true;
 		}
 	);
 
+	return FDiversionModule::Get().RepositoryWorkspaceManipulationAPIRequestManager->SrcHandlersv2WorkspaceGetOtherStatuses(
+		InCommand.WsInfo.RepoID, InCommand.WsInfo.WorkspaceID, TOptional<FString>(), InRelativePrefixes, TOptional<int32>(), TOptional<int32>(), InRecurse,
+		FDiversionModule::Get().GetAccessToken(InCommand.WsInfo.AccountID), {}, 5, 120).HandleApiResponse(ErrorResponse, VariantResponse, OutErrorMessages);
+}
 
-	const int PrefixesLimit = 20;
-	bool Success = true;
 
+bool DiversionUtils::GetPotentialFileClashes(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages,
+TArray<FString>& OutErrorMessages, TMap<FString, TArray<EDiversionPotentialClashInfo>>& OutPotentialClashes, bool& OutRecurseCall,
+	int32 InMaxParallelRequests, const FThreadSafeBool* InCancelled)
+{
 	// Recurse request if the full repo is being updated
 	bool FullRepoUpdateRequested = (InCommand.Files.Num() == 1) && (InCommand.Files[0] == InCommand.WsInfo.GetPath());
 	bool Recurse = FullRepoUpdateRequested;
 	OutRecurseCall = FullRepoUpdateRequested;
-	
-	TArray<FString> FullPrefixesArray = GetPathsCommonPrefixes(InCommand.Files, InCommand.WsInfo.GetPath()).Array();
-	int PrefixesRequestOffset = 0;
-
-	while (PrefixesRequestOffset < FullPrefixesArray.Num()) {
-		// Get the relevant prefixes to sent to the BE in the current request
-		
-		if(!DiversionUtils::DiversionValidityCheck(PrefixesRequestOffset < FullPrefixesArray.Num(), 
-			"PrefixesRequestOffset is greater than FullPrefixesArray.Num()!", InCommand.WsInfo.AccountID)) 
-		{
-			// Should never happen!
-			break;
-		}
 
-		// Try taking as much elements as possible left in the FullPrefixesArray, but not passing the limit
-		int ElemensToTake = FullPrefixesArray.Num() - PrefixesRequestOffset < PrefixesLimit ? (FullPrefixesArray.Num() - PrefixesRequestOffset) : PrefixesLimit;
-		if (!DiversionUtils::DiversionValidityCheck(PrefixesRequestOffset + ElemensToTake <= FullPrefixesArray.Num(),
-			"Tried slicing the FullPrefixesArray for more than its contents...", InCommand.WsInfo.AccountID))
-		{
-			// Should never happen!
-			break;
-		}
+	InCommand.StatCache.Prefetch(InCommand.Files);
+	TArray<FString> FullPrefixesArray = GetPathsCommonPrefixes(InCommand.Files, InCommand.WsInfo.GetPath(), InCommand.StatCache).Array();
 
-		auto PartialPrefixesView = TArrayView<FString>(&FullPrefixesArray[PrefixesRequestOffset], ElemensToTake);
+	// Split the prefixes in batches of up to PrefixesLimit relative paths
+	TArray<TArray<FString>> Batches;
+	for (int PrefixIndex = 0; PrefixIndex < FullPrefixesArray.Num(); ++PrefixIndex) {
+		if (PrefixIndex % PrefixesLimit == 0) {
+			Batches.AddDefaulted();
+		}
+		Batches.Last().Add(DiversionUtils::ConvertFullPathToRelative(FullPrefixesArray[PrefixIndex], InCommand.WsInfo.GetPath()));
+	}
 
-		// Convert view to array with relative paths
-		TArray<FString> RelativePartialPrefixesArray;
-		for (auto& Prefix : PartialPrefixesView) {
-			RelativePartialPrefixesArray.Add(DiversionUtils::ConvertFullPathToRelative(Prefix, InCommand.WsInfo.GetPath()));
+	// Each task takes the next batch until none are left, a failure or a cancellation stops all of them
+	struct FBatchesResult
+	{
+		TArray<FString> ErrorMessages;
+		TMap<FString, TArray<EDiversionPotentialClashInfo>> PotentialClashes;
+	};
+	// The extra tasks take step slots, shared with the other commands
+	const int32 NumTasks = 1 + DiversionCommandSteps::TryAcquireSlots(FMath::Clamp(InMaxParallelRequests, 1, FMath::Max(Batches.Num(), 1)) - 1);
+	TArray<FBatchesResult> TasksResults;
+	TasksResults.SetNum(NumTasks);
+	std::atomic<int32> NextBatch{0};
+	std::atomic<bool> bFailed{false};
+
+	auto RunBatches = [&](FBatchesResult& OutResult) {
+		for (int32 BatchIndex = NextBatch++; BatchIndex < Batches.Num() && !bFailed; BatchIndex = NextBatch++) {
+			if (InCancelled != nullptr && *InCancelled) {
+				bFailed = true;
+				break;
+			}
+			if (!RequestPotentialClashesBatch(InCommand, Batches[BatchIndex], Recurse, OutResult.ErrorMessages, OutResult.PotentialClashes)) {
+				bFailed = true;
+			}
 		}
+	};
+
+	// This thread runs a share of the batches as well
+	TArray<UE::Tasks::TTask<void>> Tasks;
+	for (int32 TaskIndex = 1; TaskIndex < NumTasks; ++TaskIndex) {
+		// The requests block on the network, keep them off the foreground workers
+		Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [&RunBatches, &TasksResults, TaskIndex]() {
+			RunBatches(TasksResults[TaskIndex]);
+			DiversionCommandSteps::ReleaseSlots(1);
+		}, UE::Tasks::ETaskPriority::BackgroundNormal));
+	}
+	RunBatches(TasksResults[0]);
+	UE::Tasks::Wait(Tasks);
 
-		// Send request of the current offset
-		Success &= FDiversionModule::Get().RepositoryWorkspaceManipulationAPIRequestManager->SrcHandlersv2WorkspaceGetOtherStatuses(
-			InCommand.WsInfo.RepoID, InCommand.WsInfo.WorkspaceID, TOptional<FString>(), RelativePartialPrefixesArray, TOptional<int32>(), TOptional<int32>(), Recurse, 
-			FDiversionModule::Get().GetAccessToken(InCommand.WsInfo.AccountID), {}, 5, 120).HandleApiResponse(ErrorResponse, VariantResponse, OutErrorMessages);
+	for (FBatchesResult& TaskResult : TasksResults) {
+		OutErrorMessages.Append(MoveTemp(TaskResult.ErrorMessages));
+		OutPotentialClashes.Append(MoveTemp(TaskResult.PotentialClashes));
+	}
 
-		if (!Success) {
-			break;
-		}
+	if (InCancelled != nullptr && *InCancelled) {
+		OutInfoMessages.Add("Potential clashes refresh was superseded by a newer one");
+		return false;
+	}
+	if (bFailed) {
+		return false;
+	}
 
-		PrefixesRequestOffset += ElemensToTake;
+	// Remove outdated potential clash data
+	const FString WsPath = InCommand.WsInfo.GetPath();
+	for (auto& Path : InCommand.Files)
+	{
+		if (!FPaths::IsUnderDirectory(Path, WsPath))
+		{
+			UE_LOG(LogSourceControl, Log, TEXT("Path: %s is not contained in the repo, skipping."), *Path);
+			continue;
+		}
+		auto FullStatusFilePath = DiversionUtils::ConvertRelativePathToDiversionFull(Path, WsPath);
+		if (OutPotentialClashes.Contains(FullStatusFilePath)) continue;
+		// Indicate that there are no potential clashes for the file we queried
+		OutPotentialClashes.Add(FullStatusFilePath, TArray<EDiversionPotentialClashInfo>());
 	}
 
-	return Success;
-}
\ No newline at end of file
+	return true;
+}
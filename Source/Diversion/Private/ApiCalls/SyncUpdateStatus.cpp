@@ -4,31 +4,21 @@
 #include "DiversionCommand.h"
 #include "DiversionModule.h"
 #include "IDiversionStatusWorker.h"
+#include "DiversionPathPrefixSet.h"
 
 using namespace Diversion::CoreAPI;
 
 constexpr int StatusItemsLimit = 1500;
 
-bool IsPathContained(const FString& InPath, const TArray<FString>& InCommandPaths) {
-	for (auto& CommandPath : InCommandPaths)
-	{
-		if (FPaths::IsUnderDirectory(InPath, CommandPath))
-		{
-			return true;
-		}
-	}
-	return false;
-}
-
 void ParseStateFromList(const TArray<FileEntry>& InItems,
-	const FString& InWsPath, const TArray<FString>& InCommandPaths,
+	const FString& InWsPath, const FDiversionPathPrefixSet& InCommandPaths,
 	const EWorkingCopyState::Type& InState, const FDateTime& InDefaultMtime, 
-	const int InLocalRevNumber, TMap<FString, FDiversionState>& OutStates, const TArray<FString>& ConflictedFiles) {
+	const int InLocalRevNumber, TMap<FString, FDiversionState>& OutStates, const TSet<FString>& ConflictedFiles) {
 	for (const auto& File : InItems)
 	{
 		FString FullItemPath = DiversionUtils::ConvertRelativePathToDiversionFull(File.mPath, InWsPath);
 		// (Optimization): Only add state if FullItemPath is a subpath(or equal) of at least one of the InCommandPaths
-		if (!IsPathContained(FullItemPath, InCommandPaths)) continue;
+		if (!InCommandPaths.Contains(FullItemPath)) continue;
 
 		// Don't override conflicted files states if we have ongoing merge
 		if (ConflictedFiles.Contains(FullItemPath)) continue;
@@ -37,14 +27,43 @@ void ParseStateFromList(const TArray<FileEntry>& InItems,
 		FileState.WorkingCopyState = InState;
 		FileState.TimeStamp = File.mMtime.IsSet() ? File.mMtime.GetValue() : InDefaultMtime;
 		FileState.LocalRevNumber = InLocalRevNumber;
-		FileState.Hash = File.mHash.IsSet() ? File.mHash.GetValue() : TEXT("");
+		FileState.SetHash(File.mHash.IsSet() ? File.mHash.GetValue() : TEXT(""));
 		OutStates.Add(FullItemPath, FileState);
 	}
 }
 
-bool AllPathsAreFiles(const TArray<FString>& InPaths) {
+uint32 HashFileEntries(const TArray<FileEntry>& InItems, uint32 InHash) {
+	InHash = HashCombine(InHash, GetTypeHash(InItems.Num()));
+	for (const auto& File : InItems)
+	{
+		InHash = HashCombine(InHash, GetTypeHash(File.mPath));
+		InHash = HashCombine(InHash, GetTypeHash(File.mHash.Get(TEXT(""))));
+		InHash = HashCombine(InHash, File.mMtime.IsSet() ? GetTypeHash(File.mMtime.GetValue()) : 0);
+	}
+	return InHash;
+}
+
+/** Hash of everything besides the status pages that the parsed states depend on */
+uint32 HashStatusRequest(const FDiversionCommand& InCommand) {
+	uint32 Hash = GetTypeHash(InCommand.WsInfo.WorkspaceID);
+	Hash = HashCombine(Hash, GetTypeHash(InCommand.WsInfo.CommitID));
+	Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(InCommand.SyncStatus)));
+	for (const FString& Path : InCommand.Files)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Path));
+	}
+	// Set iteration order isn't stable between rebuilt sets, combine the paths order independently
+	uint32 ConflictedFilesHash = 0;
+	for (const FString& Path : InCommand.ConflictedFiles)
+	{
+		ConflictedFilesHash += GetTypeHash(Path);
+	}
+	return HashCombine(Hash, ConflictedFilesHash);
+}
+
+bool AllPathsAreFiles(const TArray<FString>& InPaths, FDiversionStatCache& InStatCache) {
 	for (auto& Path : InPaths) {
-		if (FPaths::DirectoryExists(Path)) {
+		if (InStatCache.IsDirectory(Path)) {
 			return false;
 		}
 	}
@@ -54,9 +73,16 @@ bool AllPathsAreFiles(const TArray<FString>& InPaths) {
 
 
 bool DiversionUtils::RunUpdateStatus(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, 
-	TArray<FString>& OutErrorMessages, bool WaitForSync){
+	TArray<FString>& OutErrorMessages, bool WaitForSync, bool bSkipUnchanged){
 
 	IDiversionStatusWorker& Worker = static_cast<IDiversionStatusWorker&>(InCommand.Worker.Get());
+	// The pages are parsed once all of them are in, and only if they differ from the status the states cache matches
+	TArray<TSharedPtr<WorkspaceStatus>> Pages;
+	uint32 Fingerprint = HashStatusRequest(InCommand);
+	// Built once for all the pages - UE might ask for the status of thousands of files
+	const FDiversionPathPrefixSet CommandPaths(InCommand.Files);
+	FDiversionStatCache& StatCache = InCommand.StatCache;
+	StatCache.Prefetch(InCommand.Files);
 	auto ErrorResponse = RepositoryWorkspaceManipulationApi::Fsrc_handlersv2_workspace_getStatusDelegate::Bind(
 		[&]() {
 			return false;
@@ -85,44 +111,11 @@ bool DiversionUtils::RunUpdateStatus(const FDiversionCommand& InCommand, TArray<
 				return false;
 			}
 
-			// Since the command paths might be a superset of the paths in the response, we need to 
-			// traverse the response and update the states accordingly
-			auto& Items = Value->mItems.GetValue();
-
-			const FDateTime Now = FDateTime::Now();
-			const int LocalRevNumber = DiversionUtils::GetWorkspaceRevisionByCommit(InCommand.WsInfo.CommitID);
-			const FString WsPath = InCommand.WsInfo.GetPath();
-
-			// Handle controlled files
-			ParseStateFromList(Items.mr_new, WsPath, InCommand.Files, EWorkingCopyState::Added, Now, LocalRevNumber, Worker.States, InCommand.ConflictedFiles);
-			ParseStateFromList(Items.mModified, WsPath, InCommand.Files, EWorkingCopyState::Modified, Now, LocalRevNumber, Worker.States, InCommand.ConflictedFiles);
-			ParseStateFromList(Items.mDeleted, WsPath, InCommand.Files, EWorkingCopyState::Deleted, Now, LocalRevNumber, Worker.States, InCommand.ConflictedFiles);
-
-			// Handle non-controlled files
-			for (auto& Path : InCommand.Files) {
-				// The assumption is UE provides us absolute path
-				if (!FPaths::IsUnderDirectory(Path, WsPath))
-				{
-					UE_LOG(LogSourceControl, Log, TEXT("Path: %s is not contained in the repo, skipping."), *Path);
-					continue;
-				}
-
-				// Skip if the path was already handled
-				// TODO: handle readding a deleted file before saving it
-				if (Worker.States.Contains(Path)) continue;
-
-				FDiversionState FileState(Path);
-
-				if (FPaths::FileExists(Path) || FPaths::DirectoryExists(Path)) {
-					FileState.WorkingCopyState = EWorkingCopyState::Unchanged;
-					// Set the timestamp to the last write time
-					FileState.TimeStamp = FPlatformFileManager::Get().GetPlatformFile().GetTimeStamp(*Path);
-				}
-				else {
-					FileState.WorkingCopyState = EWorkingCopyState::NotControlled;
-				}
-				Worker.States.Add(Path, FileState);
-			}
+			const auto& Items = Value->mItems.GetValue();
+			Fingerprint = HashFileEntries(Items.mr_new, Fingerprint);
+			Fingerprint = HashFileEntries(Items.mModified, Fingerprint);
+			Fingerprint = HashFileEntries(Items.mDeleted, Fingerprint);
+			Pages.Add(Value);
 
 			// This is only relevant to know if an update operation is needed or not
 			// in the context of UE plugin
@@ -138,10 +131,10 @@ bool DiversionUtils::RunUpdateStatus(const FDiversionCommand& InCommand, TArray<
 
 
 
-	TArray<FString> CommonPrefixes = GetPathsCommonPrefixes(InCommand.Files, InCommand.WsInfo.GetPath()).Array();
+	TArray<FString> CommonPrefixes = GetPathsCommonPrefixes(InCommand.Files, InCommand.WsInfo.GetPath(), StatCache).Array();
 
 	// Avoid recursive status requests if all paths are files and on the same directory
-	bool bRequestStatusOfOnlyOneDirectory = AllPathsAreFiles(InCommand.Files) && CommonPrefixes.Num() == 1;
+	bool bRequestStatusOfOnlyOneDirectory = AllPathsAreFiles(InCommand.Files, StatCache) && CommonPrefixes.Num() == 1;
 	Worker.bRecursiveRequest = !bRequestStatusOfOnlyOneDirectory;
 	
 	FString AncestorPrefix = DiversionUtils::ConvertFullPathToRelative(FindCommonAncestorDirectory(InCommand.Files),
@@ -154,11 +147,64 @@ bool DiversionUtils::RunUpdateStatus(const FDiversionCommand& InCommand, TArray<
 			InCommand.WsInfo.RepoID, InCommand.WsInfo.WorkspaceID, true, StatusItemsLimit, RequestOffset, !bRequestStatusOfOnlyOneDirectory,
 			AncestorPrefix, false, FDiversionModule::Get().GetAccessToken(InCommand.WsInfo.AccountID), {}, 5, 120).HandleApiResponse(ErrorResponse, VariantResponse, OutInfoMessages);
 	
-		if (!Worker.bIncompleteResult) {
+		if (!Success || !Worker.bIncompleteResult) {
 			break;
 		}
 		RequestOffset += Worker.ItemsFetchedNum;
 	}
 
-	return Success;
+	if (!Success) {
+		return false;
+	}
+
+	Worker.StatusFingerprint = Fingerprint;
+	Worker.bStatusUnchanged = bSkipUnchanged && Fingerprint != 0 && Fingerprint == InCommand.ProviderSnapshot->StatusFingerprint;
+	if (Worker.bStatusUnchanged) {
+		// Nothing to parse - the states cache already holds the result
+		return true;
+	}
+
+	const FDateTime Now = FDateTime::Now();
+	const int LocalRevNumber = DiversionUtils::GetWorkspaceRevisionByCommit(InCommand.WsInfo.CommitID);
+	const FString WsPath = InCommand.WsInfo.GetPath();
+
+	// Since the command paths might be a superset of the paths in the response, we need to 
+	// traverse the response and update the states accordingly
+	for (const TSharedPtr<WorkspaceStatus>& Page : Pages) {
+		const auto& Items = Page->mItems.GetValue();
+
+		// Handle controlled files
+		ParseStateFromList(Items.mr_new, WsPath, CommandPaths, EWorkingCopyState::Added, Now, LocalRevNumber, Worker.States, InCommand.ConflictedFiles);
+		ParseStateFromList(Items.mModified, WsPath, CommandPaths, EWorkingCopyState::Modified, Now, LocalRevNumber, Worker.States, InCommand.ConflictedFiles);
+		ParseStateFromList(Items.mDeleted, WsPath, CommandPaths, EWorkingCopyState::Deleted, Now, LocalRevNumber, Worker.States, InCommand.ConflictedFiles);
+	}
+
+	// Handle non-controlled files
+	for (auto& Path : InCommand.Files) {
+		// The assumption is UE provides us absolute path
+		if (!FPaths::IsUnderDirectory(Path, WsPath))
+		{
+			UE_LOG(LogSourceControl, Log, TEXT("Path: %s is not contained in the repo, skipping."), *Path);
+			continue;
+		}
+
+		// Skip if the path was already handled
+		// TODO: handle readding a deleted file before saving it
+		if (Worker.States.Contains(Path)) continue;
+
+		FDiversionState FileState(Path);
+
+		const FDiversionPathStat PathStat = StatCache.Get(Path);
+		if (PathStat.bExists) {
+			FileState.WorkingCopyState = EWorkingCopyState::Unchanged;
+			// Set the timestamp to the last write time
+			FileState.TimeStamp = PathStat.TimeStamp;
+		}
+		else {
+			FileState.WorkingCopyState = EWorkingCopyState::NotControlled;
+		}
+		Worker.States.Add(Path, FileState);
+	}
+
+	return true;
 }
\ No newline at end of file
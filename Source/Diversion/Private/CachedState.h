@@ -4,58 +4,111 @@
 #include "Containers/Ticker.h"
 #include "DiversionUtils.h"
 #include "ISourceControlModule.h"
+#include "Misc/ScopeRWLock.h"
 
 DECLARE_DELEGATE(FOnCacheUpdate);
 
 
-// A class that represents a value that will be cached and updated when needed
+// A class that represents a value that will be cached and updated when needed.
+// Reads never wait for a refresh (stale-while-revalidate): a stale value is returned as is while a single
+// refresh is started, and is only replaced by the "nil" value once it's older than the optional hard expiry.
+// All the members are safe to call from any thread.
 template <typename T>
 class TCached final
 {
 public:
-	explicit TCached(T DefaultValue, const FTimespan& InCheckInterval = FTimespan::FromSeconds(30))
-	:  CheckInterval(InCheckInterval), Value(DefaultValue){}
+	explicit TCached(T DefaultValue, const FTimespan& InCheckInterval = FTimespan::FromSeconds(30),
+		const FTimespan& InHardExpiry = FTimespan::Zero())
+	:  CheckInterval(InCheckInterval), HardExpiry(InHardExpiry), Value(DefaultValue){}
 
-	const T* GetValid() {
-		if(LastCheckTime + CheckInterval < FDateTime::Now())
+	/** The value, unless it's stale */
+	TOptional<T> GetValid() const {
+		FReadScopeLock Lock(ValueLock);
+		if(LastSetTime + CheckInterval < FDateTime::Now())
 		{
-			return nullptr;
+			return TOptional<T>();
 		}
-		return &Value;
+		return Value;
 	}
 
-	const T& GetUpdate(T NilValue, FOnCacheUpdate InOnUpdate = FOnCacheUpdate(), bool InForceUpdate = false) {
-		const T* Temp = InForceUpdate ? nullptr : GetValid();
-		if(Temp == nullptr)
+	/**
+	 * Returns the cached value right away, calling InOnUpdate to refresh it if it's stale.
+	 * The update is expected to Set() the value, either right away or later on (e.g. from an asynchronous command).
+	 * Only one refresh is in flight at a time - a refresh that didn't Set() the value within the check interval
+	 * is considered lost and the next call starts another one.
+	 * @param NilValue returned instead of a value older than the hard expiry
+	 * @param InForceUpdate start a refresh even if the value is fresh or a refresh is already in flight
+	 */
+	T GetUpdate(T NilValue, FOnCacheUpdate InOnUpdate = FOnCacheUpdate(), bool InForceUpdate = false) {
+		bool bStartRefresh = false;
 		{
-			// Mark that we queried
-			LastCheckTime = FDateTime::Now();
-			InOnUpdate.ExecuteIfBound();
-			Temp = GetValid();
-			if (Temp == nullptr) {
-				// "Reset" the contents to some empty symbolizing value
-				Value = NilValue;
+			const FDateTime Now = FDateTime::Now();
+			FWriteScopeLock Lock(ValueLock);
+			const bool bStale = LastSetTime + CheckInterval < Now;
+			const bool bRefreshLost = RefreshStartTime + CheckInterval < Now;
+			if(InForceUpdate || (bStale && (!bRefreshInFlight || bRefreshLost)))
+			{
+				bRefreshInFlight = true;
+				RefreshStartTime = Now;
+				bStartRefresh = true;
 			}
 		}
+
+		// Outside of the lock - the update might Set() the value synchronously
+		if(bStartRefresh)
+		{
+			InOnUpdate.ExecuteIfBound();
+		}
+
+		FReadScopeLock Lock(ValueLock);
+		if(HardExpiry > FTimespan::Zero() && LastSetTime + HardExpiry < FDateTime::Now())
+		{
+			return NilValue;
+		}
 		return Value;
 	}
 
-	const T& Get() const {
+	T Get() const {
+		FReadScopeLock Lock(ValueLock);
+		return Value;
+	}
+
+	/** The value like GetUpdate() would return it, without starting a refresh */
+	T GetUnexpired(T NilValue) const {
+		FReadScopeLock Lock(ValueLock);
+		if(HardExpiry > FTimespan::Zero() && LastSetTime + HardExpiry < FDateTime::Now())
+		{
+			return NilValue;
+		}
 		return Value;
 	}
 
 	void Set(const T& InValue) {
+		FWriteScopeLock Lock(ValueLock);
 		Value = InValue;
-		LastCheckTime = FDateTime::Now();
+		LastSetTime = FDateTime::Now();
+		bRefreshInFlight = false;
 	}
 
 	void ResetTimer() {
 		// Force a refresh
-		LastCheckTime = FDateTime::MinValue();
+		FWriteScopeLock Lock(ValueLock);
+		LastSetTime = FDateTime::MinValue();
+		bRefreshInFlight = false;
+	}
+
+	bool IsRefreshInFlight() const {
+		FReadScopeLock Lock(ValueLock);
+		return bRefreshInFlight;
 	}
-	
+
 private:
-	FDateTime LastCheckTime;
+	mutable FRWLock ValueLock;
+	FDateTime LastSetTime;
+	FDateTime RefreshStartTime;
+	bool bRefreshInFlight = false;
 	FTimespan CheckInterval;
+	/** Age past which the value isn't served anymore, zero for never */
+	FTimespan HardExpiry;
 	T Value;
 };
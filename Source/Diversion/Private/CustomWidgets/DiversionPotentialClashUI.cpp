@@ -31,6 +31,33 @@ TSharedPtr<FDiversionState, ESPMode::ThreadSafe> GetDiversionStateForAsset(FStri
 }
 
 
+void FPotentialClashDisplayCache::Refresh() const
+{
+	TSharedPtr<FDiversionState, ESPMode::ThreadSafe> DiversionState = State.Pin();
+	if (!DiversionState)
+	{
+		// Not resolved yet, or evicted from the provider state cache since
+		DiversionState = GetDiversionStateForAsset(AssetPath);
+		State = DiversionState;
+		PotentialClashesVersion.Reset();
+		if (!DiversionState)
+		{
+			bHasPotentialClashes = false;
+			Tooltip = FText();
+			return;
+		}
+	}
+
+	if (PotentialClashesVersion.IsSet() && PotentialClashesVersion.GetValue() == DiversionState->GetPotentialClashesVersion())
+	{
+		return;
+	}
+	PotentialClashesVersion = DiversionState->GetPotentialClashesVersion();
+	bHasPotentialClashes = DiversionState->GetPotentialClashesCount() > 0;
+	Tooltip = bHasPotentialClashes ? FText::FromString(DiversionState->GetOtherEditorsList()) : FText();
+}
+
+
 const FSlateBrush* SPotentialClashIndicator::PotentialClashIcon = nullptr;
 
 /**
@@ -40,7 +67,7 @@ const FSlateBrush* SPotentialClashIndicator::PotentialClashIcon = nullptr;
 
 void SPotentialClashIndicator::Construct(const FArguments& InArgs)
 {
-	AssetPath = InArgs._AssetPath;
+	DisplayCache.SetAssetPath(InArgs._AssetPath);
 	SetVisibility(MakeAttributeSP(this, &SPotentialClashIndicator::GetVisibility));
 
 	ChildSlot
@@ -83,16 +110,6 @@ void SPotentialClashIndicator::CacheIndicatorBrush()
 	}
 }
 
-bool SPotentialClashIndicator::IsAssetHasPotentialClashes(FString Path)
-{
-	TSharedPtr<FDiversionState, ESPMode::ThreadSafe> DiversionState = GetDiversionStateForAsset(Path);
-	if (!DiversionState)
-	{
-		return false;
-	}
-	return DiversionState->PotentialClashes.GetPotentialClashesCount() > 0;
-}
-
 /**
 * Construct this widget.
 * @param InArgs Slate arguments
@@ -100,7 +117,7 @@ bool SPotentialClashIndicator::IsAssetHasPotentialClashes(FString Path)
 
 void SPotentialClashTooltip::Construct(const FArguments& InArgs)
 {
-	AssetPath = InArgs._AssetPath;
+	DisplayCache.SetAssetPath(InArgs._AssetPath);
 	SetVisibility(MakeAttributeSP(this, &SPotentialClashTooltip::GetVisibility));
 
 	ChildSlot
@@ -109,23 +126,3 @@ void SPotentialClashTooltip::Construct(const FArguments& InArgs)
 				.Text(this, &SPotentialClashTooltip::GetTooltip)
 		];
 }
-
-bool SPotentialClashTooltip::IsAssetHasPotentialClashes(FString Path)
-{
-	TSharedPtr<FDiversionState, ESPMode::ThreadSafe> DiversionState = GetDiversionStateForAsset(Path);
-	if (!DiversionState)
-	{
-		return false;
-	}
-	return DiversionState->PotentialClashes.GetPotentialClashesCount() > 0;
-}
-
-FText SPotentialClashTooltip::GetTooltip() const
-{
-	TSharedPtr<FDiversionState, ESPMode::ThreadSafe> DiversionState = GetDiversionStateForAsset(AssetPath);
-	if (!DiversionState)
-	{
-		return FText();
-	}
-	return FText::FromString(DiversionState->GetOtherEditorsList());
-}
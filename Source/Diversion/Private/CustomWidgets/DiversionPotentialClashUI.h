@@ -4,6 +4,42 @@
 
 #include "Widgets/SCompoundWidget.h"
 
+class FDiversionState;
+
+/**
+ * What the clash widgets of an asset show, derived from its state.
+ * The state is resolved once and the rest is only recomputed when the provider bumps its clashes version,
+ * since the widgets query it every frame for each visible asset.
+ */
+class FPotentialClashDisplayCache
+{
+public:
+	void SetAssetPath(const FString& InAssetPath) { AssetPath = InAssetPath; }
+
+	bool HasPotentialClashes() const
+	{
+		Refresh();
+		return bHasPotentialClashes;
+	}
+
+	const FText& GetTooltip() const
+	{
+		Refresh();
+		return Tooltip;
+	}
+
+private:
+	void Refresh() const;
+
+	/** Asset path of the widget */
+	FString AssetPath;
+
+	mutable TWeakPtr<FDiversionState, ESPMode::ThreadSafe> State;
+	mutable TOptional<uint16> PotentialClashesVersion;
+	mutable bool bHasPotentialClashes = false;
+	mutable FText Tooltip;
+};
+
 class SPotentialClashIndicator : public SCompoundWidget
 {
 public:
@@ -24,22 +60,20 @@ public:
 
 private:
 
-	static bool IsAssetHasPotentialClashes(FString Path);
-
 	EVisibility GetVisibility() const
 	{
-		return IsAssetHasPotentialClashes(AssetPath) ? EVisibility::Visible : EVisibility::Collapsed;
+		return DisplayCache.HasPotentialClashes() ? EVisibility::Visible : EVisibility::Collapsed;
 	}
 
 	const FSlateBrush* GetImageBrush() const
 	{
-		return IsAssetHasPotentialClashes(AssetPath) ? PotentialClashIcon : nullptr;
+		return DisplayCache.HasPotentialClashes() ? PotentialClashIcon : nullptr;
 	}
 
 	static const FSlateBrush* PotentialClashIcon;
 
-	/** Asset path for this indicator widget.*/
-	FString AssetPath;
+	/** Clash status of the asset of this indicator widget.*/
+	FPotentialClashDisplayCache DisplayCache;
 };
 
 
@@ -59,17 +93,18 @@ public:
 	virtual ~SPotentialClashTooltip() = default;
 private:
 
-	static bool IsAssetHasPotentialClashes(FString Path);
-
 	EVisibility GetVisibility() const
 	{
-		return IsAssetHasPotentialClashes(AssetPath) ? EVisibility::Visible : EVisibility::Collapsed;
+		return DisplayCache.HasPotentialClashes() ? EVisibility::Visible : EVisibility::Collapsed;
 	}
 
-	FText GetTooltip() const;
+	FText GetTooltip() const
+	{
+		return DisplayCache.GetTooltip();
+	}
 
-	/** Asset path for this indicator widget.*/
-	FString AssetPath;
+	/** Clash status of the asset of this indicator widget.*/
+	FPotentialClashDisplayCache DisplayCache;
 };
 
 
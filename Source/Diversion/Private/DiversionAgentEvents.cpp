@@ -0,0 +1,171 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "DiversionAgentEvents.h"
+
+#include "DefaultApi.h"
+#include "DiversionConstants.h"
+#include "DiversionUtils.h"
+#include "ISourceControlModule.h"
+#include "Async/Async.h"
+
+using namespace Diversion::AgentAPI;
+
+namespace
+{
+	bool IsEventsEndpointMissing(int StatusCode)
+	{
+		// Agents predating the events endpoint
+		return StatusCode == 404 || StatusCode == 405 || StatusCode == 501;
+	}
+}
+
+FDiversionAgentEventSubscription::FDiversionAgentEventSubscription(const TSharedRef<DefaultApi>& InAgentApi,
+	const FString& InRepoID, const FString& InWorkspaceID, const FString& InWorkspacePath)
+	: AgentApi(InAgentApi)
+	, RepoID(InRepoID)
+	, WorkspaceID(InWorkspaceID)
+	, WorkspacePath(InWorkspacePath)
+{
+}
+
+void FDiversionAgentEventSubscription::Start()
+{
+	check(!bRunning);
+	bRunning = true;
+	// A detached thread, the subscription lives until the thread returned
+	Async(EAsyncExecution::Thread, [This = AsShared()]() {
+		This->Run();
+	});
+}
+
+void FDiversionAgentEventSubscription::RequestStop()
+{
+	bStopRequested = true;
+	WakeUpEvent->Trigger();
+}
+
+void FDiversionAgentEventSubscription::ConsumeEvents(TArray<FDiversionAgentEvent>& OutEvents)
+{
+	FDiversionAgentEvent Event;
+	while (Events.Dequeue(Event))
+	{
+		OutEvents.Add(MoveTemp(Event));
+	}
+}
+
+void FDiversionAgentEventSubscription::RefreshAgentVersion(TCached<FDiversionVersion>& InAgentVersion)
+{
+	if (!bAnswered.exchange(false))
+	{
+		return;
+	}
+	const FDiversionVersion Version = InAgentVersion.GetUnexpired(FDiversionVersion(""));
+	if (Version.IsValid())
+	{
+		InAgentVersion.Set(Version);
+	}
+}
+
+void FDiversionAgentEventSubscription::Run()
+{
+	while (!bStopRequested)
+	{
+		if (!Poll())
+		{
+			break;
+		}
+	}
+	bConnected = false;
+	bRunning = false;
+}
+
+bool FDiversionAgentEventSubscription::Poll()
+{
+	auto Result = AgentApi->GetWorkspaceEvents(RepoID, WorkspaceID, Cursor, SECONDS_AGENT_EVENTS_LONG_POLL, FString(), {},
+		5, SECONDS_AGENT_EVENTS_LONG_POLL + 10);
+	if (bStopRequested)
+	{
+		return false;
+	}
+
+	if (!Result.IsSuccess())
+	{
+		if (IsEventsEndpointMissing(Result.StatusCode))
+		{
+			UE_LOG(LogSourceControl, Log, TEXT("Diversion agent doesn't support workspace events, polling the workspace status instead"));
+			bSupported = false;
+			Disconnect();
+			return false;
+		}
+		if (Result.StatusCode == 410)
+		{
+			// Missed events - start over from now on, after refreshing everything
+			Cursor.Reset();
+			Events.Enqueue(FDiversionAgentEvent());
+			return true;
+		}
+
+		UE_LOG(LogSourceControl, Verbose, TEXT("Diversion agent events long poll failed (%d): %s"), Result.StatusCode, *Result.Error);
+		Disconnect();
+		// The agent is probably down or restarting, the provider polls meanwhile
+		WakeUpEvent->Wait(FTimespan::FromSeconds(SECONDS_AGENT_EVENTS_RETRY));
+		return true;
+	}
+
+	if (!Result.Value.IsSet() || !Result.Value->IsType<TSharedPtr<WorkspaceEvents>>())
+	{
+		return true;
+	}
+	const TSharedPtr<WorkspaceEvents> Value = Result.Value->Get<TSharedPtr<WorkspaceEvents>>();
+	bAnswered = true;
+
+	if (!bConnected)
+	{
+		// Anything that happened before (or while disconnected) is unknown, unless the agent replays it from the cursor
+		if (!Cursor.IsSet())
+		{
+			Events.Enqueue(FDiversionAgentEvent());
+		}
+		bConnected = true;
+	}
+	Cursor = Value->mCursor;
+
+	for (const WorkspaceEvent& AgentEvent : Value->mEvents)
+	{
+		FDiversionAgentEvent Event;
+		switch (AgentEvent.mType)
+		{
+		case WorkspaceEvent::TypeEnum::FILES_CHANGED:
+			Event.Type = FDiversionAgentEvent::EType::FilesChanged;
+			if (AgentEvent.mPaths.IsSet())
+			{
+				for (const FString& RelativePath : AgentEvent.mPaths.GetValue())
+				{
+					Event.Paths.Add(DiversionUtils::ConvertRelativePathToDiversionFull(RelativePath, WorkspacePath));
+				}
+			}
+			if (Event.Paths.IsEmpty())
+			{
+				continue;
+			}
+			break;
+		case WorkspaceEvent::TypeEnum::SYNC_PROGRESS:
+			Event.Type = FDiversionAgentEvent::EType::SyncProgress;
+			Event.bIsSyncComplete = AgentEvent.mIsSyncComplete.Get(false);
+			Event.bIsPaused = AgentEvent.mIsPaused.Get(false);
+			break;
+		case WorkspaceEvent::TypeEnum::WORKSPACE_SWITCHED:
+			Event.Type = FDiversionAgentEvent::EType::WorkspaceSwitched;
+			break;
+		default:
+			continue;
+		}
+		Events.Enqueue(MoveTemp(Event));
+	}
+	return true;
+}
+
+void FDiversionAgentEventSubscription::Disconnect()
+{
+	bConnected = false;
+}
@@ -0,0 +1,110 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CachedState.h"
+#include "Containers/Queue.h"
+#include "DiversionVersion.h"
+#include "HAL/Event.h"
+
+#include <atomic>
+
+namespace Diversion::AgentAPI
+{
+	class DefaultApi;
+}
+
+/** A workspace change reported by the agent, see FDiversionAgentEventSubscription */
+struct FDiversionAgentEvent
+{
+	enum class EType : uint8
+	{
+		/** Files were modified locally or by the sync - Paths holds their absolute paths */
+		FilesChanged,
+		/** The sync state changed */
+		SyncProgress,
+		/** The workspace was switched to another branch or commit */
+		WorkspaceSwitched,
+		/** Events were missed (the agent dropped them or restarted) - everything has to be refreshed */
+		Resync
+	};
+
+	EType Type = EType::Resync;
+	TArray<FString> Paths;
+	bool bIsSyncComplete = false;
+	bool bIsPaused = false;
+};
+
+/**
+ * Subscription to the agent workspace events, long polling the agent from a dedicated thread.
+ * While connected, the agent pushes file changes, sync progress and workspace switches,
+ * so the provider doesn't need to poll the workspace status.
+ * An agent without the events endpoint marks the subscription unsupported and the thread exits.
+ *
+ * The long poll can't be interrupted, so nothing ever waits for the thread: it holds a reference to the
+ * subscription and exits on its own once the poll it's in returns. Must be owned by a shared pointer.
+ */
+class FDiversionAgentEventSubscription final : public TSharedFromThis<FDiversionAgentEventSubscription, ESPMode::ThreadSafe>
+{
+public:
+	FDiversionAgentEventSubscription(const TSharedRef<Diversion::AgentAPI::DefaultApi>& InAgentApi,
+		const FString& InRepoID, const FString& InWorkspaceID, const FString& InWorkspacePath);
+
+	FDiversionAgentEventSubscription(const FDiversionAgentEventSubscription&) = delete;
+	FDiversionAgentEventSubscription& operator=(const FDiversionAgentEventSubscription&) = delete;
+
+	void Start();
+
+	/** Asks the thread to exit once the current long poll returns, without waiting for it */
+	void RequestStop();
+
+	bool IsRunning() const { return bRunning; }
+
+	/** True while the agent answers the long polls */
+	bool IsConnected() const { return bConnected; }
+
+	/** False once the agent answered it has no events endpoint */
+	bool IsSupported() const { return bSupported; }
+
+	const FString& GetWorkspaceID() const { return WorkspaceID; }
+
+	/** Moves the events received since the last call to OutEvents. Single consumer */
+	void ConsumeEvents(TArray<FDiversionAgentEvent>& OutEvents);
+
+	/**
+	 * Refreshes the cached agent version if the agent answered a long poll since the last call - an answering agent is alive,
+	 * so the version doesn't reach its hard expiry while the events stream. A version the health check didn't set yet is left as is
+	 */
+	void RefreshAgentVersion(TCached<FDiversionVersion>& InAgentVersion);
+
+private:
+	/** Body of the thread, polls until stopped */
+	void Run();
+
+	/** Runs a single long poll, returns false if the subscription should end */
+	bool Poll();
+
+	void Disconnect();
+
+private:
+	const TSharedRef<Diversion::AgentAPI::DefaultApi> AgentApi;
+	const FString RepoID;
+	const FString WorkspaceID;
+	const FString WorkspacePath;
+
+	/** Position in the agent event stream, unset until the first answer (subscribe from now on) */
+	TOptional<int64> Cursor;
+
+	TQueue<FDiversionAgentEvent, EQueueMode::Spsc> Events;
+
+	std::atomic<bool> bStopRequested = false;
+	std::atomic<bool> bRunning = false;
+	std::atomic<bool> bConnected = false;
+	std::atomic<bool> bSupported = true;
+	/** Set by every answer of the agent, consumed by RefreshAgentVersion() */
+	std::atomic<bool> bAnswered = false;
+
+	/** Wakes the thread from the retry delay on stop */
+	FEventRef WakeUpEvent;
+};
@@ -0,0 +1,303 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "DiversionBlobCache.h"
+
+#include "ISourceControlModule.h"
+#include "DiversionConstants.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
+
+namespace
+{
+	/** Shas end up in file names, anything else than a plain digest is never cached */
+	bool IsValidSha(const FString& InSha)
+	{
+		if (InSha.IsEmpty() || InSha.Len() > 128)
+		{
+			return false;
+		}
+		for (const TCHAR Char : InSha)
+		{
+			if (!FChar::IsAlnum(Char))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Copies InBlobPath to InDestFile, computing the SHA1 of the copied content in the same pass. Never a hard link -
+	 * the diff tools and the editor may write to the files they're given, which would modify the cached blob through a link.
+	 */
+	bool CopyBlob(const FString& InBlobPath, const FString& InDestFile, FString& OutDigest)
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		PlatformFile.CreateDirectoryTree(*FPaths::GetPath(InDestFile));
+		PlatformFile.DeleteFile(*InDestFile);
+
+		TUniquePtr<IFileHandle> Source(PlatformFile.OpenRead(*InBlobPath));
+		if (!Source.IsValid())
+		{
+			return false;
+		}
+		TUniquePtr<IFileHandle> Dest(PlatformFile.OpenWrite(*InDestFile));
+		if (!Dest.IsValid())
+		{
+			return false;
+		}
+
+		FSHA1 Sha1;
+		TArray<uint8> Buffer;
+		Buffer.SetNumUninitialized(BLOB_CACHE_COPY_CHUNK_SIZE);
+		for (int64 Remaining = Source->Size(); Remaining > 0;)
+		{
+			const int64 ChunkSize = FMath::Min(Remaining, BLOB_CACHE_COPY_CHUNK_SIZE);
+			if (!Source->Read(Buffer.GetData(), ChunkSize) || !Dest->Write(Buffer.GetData(), ChunkSize))
+			{
+				Dest.Reset();
+				PlatformFile.DeleteFile(*InDestFile);
+				return false;
+			}
+			Sha1.Update(Buffer.GetData(), ChunkSize);
+			Remaining -= ChunkSize;
+		}
+		Sha1.Final();
+		uint8 Digest[FSHA1::DigestSize];
+		Sha1.GetHash(Digest);
+		OutDigest = BytesToHex(Digest, FSHA1::DigestSize);
+		return true;
+	}
+}
+
+FDiversionBlobCache::FDiversionBlobCache()
+	: CacheDir(GetDefaultCacheDir())
+{
+}
+
+FDiversionBlobCache::FDiversionBlobCache(const FString& InCacheDir)
+	: CacheDir(InCacheDir)
+{
+}
+
+FString FDiversionBlobCache::GetDefaultCacheDir()
+{
+	return FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("Diversion") / TEXT("BlobCache"));
+}
+
+FString FDiversionBlobCache::MakeTempPath(const FString& InSha) const
+{
+	return CacheDir / FString::Printf(TEXT("%s.%s.tmp"), *InSha, *FGuid::NewGuid().ToString());
+}
+
+FString FDiversionBlobCache::GetBlobPath(const FString& InSha) const
+{
+	return CacheDir / InSha;
+}
+
+FString FDiversionBlobCache::GetDigestPath(const FString& InSha) const
+{
+	return CacheDir / TEXT("Digests") / InSha;
+}
+
+bool FDiversionBlobCache::Fetch(const FString& InSha, int64 InSize, const FString& InDestFile)
+{
+	if (!IsValidSha(InSha))
+	{
+		return false;
+	}
+
+	const FString BlobPath = GetBlobPath(InSha);
+	FString ExpectedDigest;
+	{
+		FScopeLock Lock(&EntriesLock);
+		ScanCacheDir();
+		FEntry* Entry = Entries.Find(InSha);
+		if (Entry == nullptr)
+		{
+			return false;
+		}
+		if (InSize >= 0 && Entry->Size != InSize)
+		{
+			Remove(InSha);
+			return false;
+		}
+		Entry->LastAccess = FDateTime::UtcNow();
+		ExpectedDigest = Entry->Digest;
+	}
+
+	// Hits the file system, don't hold the other lookups meanwhile
+	if (ExpectedDigest.IsEmpty())
+	{
+		// Cached by a previous session
+		FFileHelper::LoadFileToString(ExpectedDigest, *GetDigestPath(InSha), FFileHelper::EHashOptions::None, FILEREAD_Silent);
+	}
+	FString Digest;
+	if (!CopyBlob(BlobPath, InDestFile, Digest))
+	{
+		// Most likely evicted meanwhile by another thread
+		UE_LOG(LogSourceControl, Verbose, TEXT("Failed fetching blob %s from the cache to %s"), *InSha, *InDestFile);
+		return false;
+	}
+
+	FScopeLock Lock(&EntriesLock);
+	if (ExpectedDigest.IsEmpty() || Digest != ExpectedDigest)
+	{
+		UE_LOG(LogSourceControl, Warning, TEXT("Cached blob %s doesn't match the content it was cached with, dropping it"), *InSha);
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*InDestFile);
+		Remove(InSha);
+		return false;
+	}
+	if (FEntry* Entry = Entries.Find(InSha))
+	{
+		Entry->Digest = MoveTemp(ExpectedDigest);
+	}
+
+	// Keeps the recency across sessions, the index is rebuilt from the timestamps
+	IFileManager::Get().SetTimeStamp(*BlobPath, FDateTime::UtcNow());
+	return true;
+}
+
+bool FDiversionBlobCache::Admit(const FString& InSha, const FString& InTempFile, const FString& InDestFile, int64 InMaxBytes)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	auto MoveToDest = [&PlatformFile, &InTempFile, &InDestFile]() {
+		PlatformFile.DeleteFile(*InDestFile);
+		if (PlatformFile.MoveFile(*InDestFile, *InTempFile))
+		{
+			return true;
+		}
+		PlatformFile.DeleteFile(*InTempFile);
+		return false;
+	};
+
+	const int64 Size = PlatformFile.FileSize(*InTempFile);
+	if (!IsValidSha(InSha) || Size > InMaxBytes)
+	{
+		// Valid, but can't be cached
+		return MoveToDest();
+	}
+
+	// Placed from the temp file we own, so an eviction racing the admit can't take the blob away from under the copy
+	FString Digest;
+	if (!CopyBlob(InTempFile, InDestFile, Digest))
+	{
+		PlatformFile.DeleteFile(*InTempFile);
+		return false;
+	}
+
+	const FString BlobPath = GetBlobPath(InSha);
+	FScopeLock Lock(&EntriesLock);
+	ScanCacheDir();
+	if (FEntry* Existing = Entries.Find(InSha))
+	{
+		// Downloaded concurrently by another thread
+		Existing->LastAccess = FDateTime::UtcNow();
+		PlatformFile.DeleteFile(*InTempFile);
+	}
+	// The digest is written first and the rename is atomic, a blob is never visible half written or without its digest
+	else if (FFileHelper::SaveStringToFile(Digest, *GetDigestPath(InSha)) && PlatformFile.MoveFile(*BlobPath, *InTempFile))
+	{
+		FEntry& Entry = Entries.Add(InSha);
+		Entry.Size = Size;
+		Entry.LastAccess = FDateTime::UtcNow();
+		Entry.Digest = MoveTemp(Digest);
+		TotalBytes += Size;
+		if (TotalBytes > InMaxBytes)
+		{
+			Evict(InMaxBytes, InSha);
+		}
+	}
+	else
+	{
+		UE_LOG(LogSourceControl, Warning, TEXT("Failed moving blob %s into the cache"), *InSha);
+		PlatformFile.DeleteFile(*InTempFile);
+		PlatformFile.DeleteFile(*GetDigestPath(InSha));
+	}
+	return true;
+}
+
+void FDiversionBlobCache::ScanCacheDir()
+{
+	if (bScanned)
+	{
+		return;
+	}
+	bScanned = true;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*CacheDir);
+
+	TArray<FString> StaleTempFiles;
+	PlatformFile.IterateDirectoryStat(*CacheDir, [this, &StaleTempFiles](const TCHAR* InPath, const FFileStatData& InStatData) {
+		if (InStatData.bIsDirectory)
+		{
+			return true;
+		}
+		const FString FileName = FPaths::GetCleanFilename(InPath);
+		if (!IsValidSha(FileName))
+		{
+			// Left behind by a download that didn't complete
+			StaleTempFiles.Add(InPath);
+			return true;
+		}
+		FEntry& Entry = Entries.Add(FileName);
+		Entry.Size = InStatData.FileSize;
+		Entry.LastAccess = InStatData.ModificationTime;
+		TotalBytes += InStatData.FileSize;
+		return true;
+	});
+
+	for (const FString& TempFile : StaleTempFiles)
+	{
+		PlatformFile.DeleteFile(*TempFile);
+	}
+	UE_LOG(LogSourceControl, Verbose, TEXT("Diversion blob cache holds %d blobs, %lld bytes"), Entries.Num(), TotalBytes);
+}
+
+void FDiversionBlobCache::Evict(int64 InMaxBytes, const FString& InKeepSha)
+{
+	TArray<TPair<FDateTime, FString>> ByAccess;
+	ByAccess.Reserve(Entries.Num());
+	for (const auto& [Sha, Entry] : Entries)
+	{
+		ByAccess.Emplace(Entry.LastAccess, Sha);
+	}
+	ByAccess.Sort([](const TPair<FDateTime, FString>& A, const TPair<FDateTime, FString>& B) {
+		return A.Key < B.Key;
+	});
+
+	const int64 TargetBytes = static_cast<int64>(InMaxBytes * BLOB_CACHE_EVICTION_LOW_WATERMARK);
+	int32 NumEvicted = 0;
+	for (const TPair<FDateTime, FString>& Candidate : ByAccess)
+	{
+		if (TotalBytes <= TargetBytes)
+		{
+			break;
+		}
+		if (Candidate.Value == InKeepSha)
+		{
+			continue;
+		}
+		Remove(Candidate.Value);
+		++NumEvicted;
+	}
+	UE_LOG(LogSourceControl, Verbose, TEXT("Evicted %d blobs from the Diversion blob cache, %lld bytes left"), NumEvicted, TotalBytes);
+}
+
+void FDiversionBlobCache::Remove(const FString& InSha)
+{
+	FEntry Entry;
+	if (Entries.RemoveAndCopyValue(InSha, Entry))
+	{
+		TotalBytes -= Entry.Size;
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		PlatformFile.DeleteFile(*GetBlobPath(InSha));
+		PlatformFile.DeleteFile(*GetDigestPath(InSha));
+	}
+}
@@ -0,0 +1,74 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+/**
+ * Content addressed store of the file blobs downloaded for diffs, keyed by their sha.
+ * The same content under different commits or paths is only downloaded once, and the least recently
+ * used blobs are evicted above the configured size. Each blob is stored along with the SHA1 of its content
+ * as admitted (the server sha can't be recomputed), and every fetch checks the copy it places against it:
+ * a blob modified or corrupted on disk, in this session or a previous one, is evicted instead of served. Thread safe.
+ */
+class FDiversionBlobCache
+{
+public:
+	FDiversionBlobCache();
+	/** A cache stored in InCacheDir instead of the default location */
+	explicit FDiversionBlobCache(const FString& InCacheDir);
+
+	/** Default location of the cache, under the project Saved directory */
+	static FString GetDefaultCacheDir();
+
+	/** A unique path in the cache directory to download a blob to before admitting it */
+	FString MakeTempPath(const FString& InSha) const;
+
+	/**
+	 * Copies the cached blob to InDestFile. It's a copy, so whatever writes to InDestFile can't corrupt the cache.
+	 * @returns false if the blob isn't cached or the copy doesn't match its digest (it's dropped from the cache then)
+	 */
+	bool Fetch(const FString& InSha, int64 InSize, const FString& InDestFile);
+
+	/**
+	 * Renames a blob downloaded to a temp file (with its size checked by the download) into the cache, and copies it to InDestFile like Fetch().
+	 * The least recently used blobs are evicted above InMaxBytes, a blob that doesn't fit is moved to InDestFile directly.
+	 * The temp file is consumed either way.
+	 * @returns false if the blob couldn't be placed at InDestFile
+	 */
+	bool Admit(const FString& InSha, const FString& InTempFile, const FString& InDestFile, int64 InMaxBytes);
+
+private:
+	struct FEntry
+	{
+		int64 Size = 0;
+		FDateTime LastAccess;
+		/** SHA1 of the content when admitted, read from its digest file on first use for the blobs of previous sessions */
+		FString Digest;
+	};
+
+	FString GetBlobPath(const FString& InSha) const;
+
+	/** The digest of a blob is kept next to it, in a subdirectory the scan of the blobs skips */
+	FString GetDigestPath(const FString& InSha) const;
+
+	/** Indexes the blobs left by previous sessions, once. Requires the lock */
+	void ScanCacheDir();
+
+	/**
+	 * Drops the least recently used blobs until the cache is below the low watermark of InMaxBytes. Requires the lock
+	 * @param InKeepSha never evicted, the blob being admitted
+	 */
+	void Evict(int64 InMaxBytes, const FString& InKeepSha);
+
+	/** Removes a blob from the index and the disk. Requires the lock */
+	void Remove(const FString& InSha);
+
+private:
+	const FString CacheDir;
+	FCriticalSection EntriesLock;
+	TMap<FString, FEntry> Entries;
+	int64 TotalBytes = 0;
+	bool bScanned = false;
+};
@@ -6,25 +6,22 @@
 #include "SourceControlHelpers.h"
 
 FDiversionCommand::FDiversionCommand(const TSharedRef<class ISourceControlOperation, ESPMode::ThreadSafe>& InOperation, const TSharedRef<class IDiversionWorker, ESPMode::ThreadSafe>& InWorker, EConcurrency::Type InConcurrency, const FSourceControlOperationComplete& InOperationCompleteDelegate)
-	: Operation(InOperation)
+	: ProviderSnapshot(FDiversionModule::Get().GetProvider().GetRevalidatedSnapshot())
+	, WsInfo(ProviderSnapshot->WsInfo)
+	, IsAgentAlive(ProviderSnapshot->IsAgentAlive)
+	, SyncStatus(ProviderSnapshot->SyncStatus)
+	, ConflictedFiles(*ProviderSnapshot->ConflictedFiles)
+	, Operation(InOperation)
 	, Worker(InWorker)
 	, OperationCompleteDelegate(InOperationCompleteDelegate)
-	, bExecuteProcessed(0)
+	, bExecuteProcessed(false)
 	, bCommandSuccessful(false)
 	, bAutoDelete(true)
 	, Concurrency(InConcurrency)
 {
-	// grab the providers settings here, so we don't access them once the worker thread is launched
+	// The providers settings are grabbed through the snapshot, so we don't access them once the worker thread is launched.
+	// It's revalidated first, an agent that didn't answer past the hard expiry is reported as not alive
 	check(IsInGameThread());
-	FDiversionModule& Diversion = FDiversionModule::Get();
-	
-	auto& Provider = Diversion.GetProvider();
-	// Get the latest values - revalidate the cache
-	WsInfo = Provider.GetWsInfo();
-	IsAgentAlive = Provider.IsAgentAlive();
-	Provider.GetConflictedFilesPaths(ConflictedFiles);
-	Provider.GetCurrentPotentialClashes(ExistingPotentialConflicts);
-	SyncStatus = Provider.GetSyncStatus();
 }
 
 void FDiversionCommand::DoWork()
@@ -34,7 +31,7 @@ void FDiversionCommand::DoWork()
 
 void FDiversionCommand::Abandon()
 {
-	FPlatformAtomics::InterlockedExchange(&bExecuteProcessed, 1);
+	SignalCompletion();
 }
 
 void FDiversionCommand::DoThreadedWork()
@@ -66,11 +63,40 @@ ECommandResult::Type FDiversionCommand::ReturnResults()
 	ECommandResult::Type Result = bCommandSuccessful ? ECommandResult::Succeeded : ECommandResult::Failed;
 	OperationCompleteDelegate.ExecuteIfBound(Operation, Result);
 
+	for (FDiversionCoalescedOperation& Coalesced : CoalescedOperations)
+	{
+		for (const FString& String : InfoMessages)
+		{
+			Coalesced.Operation->AddInfoMessge(FText::FromString(String));
+		}
+		for (const FString& String : ErrorMessages)
+		{
+			Coalesced.Operation->AddErrorMessge(FText::FromString(String));
+		}
+		Coalesced.OperationCompleteDelegate.ExecuteIfBound(Coalesced.Operation, Result);
+	}
+
 	return Result;
 }
 
 void FDiversionCommand::MarkOperationCompleted(bool InCommandSuccessful)
 {
 	bCommandSuccessful = InCommandSuccessful;
-	FPlatformAtomics::InterlockedExchange(&bExecuteProcessed, 1);
+	SignalCompletion();
+}
+
+void FDiversionCommand::SignalCompletion()
+{
+	if (bExecuteProcessed.exchange(true, std::memory_order_acq_rel) || CompletionQueue == nullptr)
+	{
+		return;
+	}
+	// The game thread may finalize and delete the command as soon as it's queued, don't touch it afterwards.
+	// The event outlives the command, so waking up the waiter after queueing is safe
+	FEvent* Event = CompletionEvent;
+	CompletionQueue->Enqueue(this);
+	if (Event != nullptr)
+	{
+		Event->Trigger();
+	}
 }
@@ -4,11 +4,26 @@
 
 #include "ISourceControlProvider.h"
 #include "Misc/IQueuedWork.h"
+#include "Containers/Queue.h"
 #include "DiversionWorkspaceInfo.h"
+#include "DiversionProviderSnapshot.h"
 #include "DiversionState.h"
 #include "DiversionUtils.h"
+#include "DiversionCommandScheduler.h"
+#include "DiversionStatCache.h"
 #include "CustomWidgets/NotificationManager.h"
 
+#include <atomic>
+
+class FEvent;
+
+/** A caller whose request was merged into another command - completes together with it */
+struct FDiversionCoalescedOperation
+{
+	FSourceControlOperationRef Operation;
+	FSourceControlOperationComplete OperationCompleteDelegate;
+};
+
 /**
  * Used to execute Diversion commands multi-threaded.
  */
@@ -46,7 +61,10 @@ public:
 
 public:
 
-	WorkspaceInfo WsInfo;
+	/** Provider state at the time the command was created - shared with every command issued until it changes */
+	FDiversionProviderSnapshotRef ProviderSnapshot;
+
+	const WorkspaceInfo& WsInfo;
 
 	bool IsAgentAlive;
 
@@ -56,7 +74,7 @@ public:
 	 */
 	DiversionUtils::EDiversionWsSyncStatus SyncStatus;
 
-	TArray<FString> ConflictedFiles;
+	const TSet<FString>& ConflictedFiles;
 
 	/** Operation we want to perform - contains outward-facing parameters & results */
 	TSharedRef<class ISourceControlOperation, ESPMode::ThreadSafe> Operation;
@@ -67,8 +85,14 @@ public:
 	/** Delegate to notify when this operation completes */
 	FSourceControlOperationComplete OperationCompleteDelegate;
 
+	/** Requests served by this command, they get the same messages and result as the command's own operation */
+	TArray<FDiversionCoalescedOperation> CoalescedOperations;
+
+	/** Lane to run on instead of the one the worker picks, set when requests of different lanes were merged */
+	TOptional<EDiversionCommandLane::Type> LaneOverride;
+
 	/** If true, this command has been processed by the version control thread*/
-	volatile int32 bExecuteProcessed;
+	std::atomic<bool> bExecuteProcessed;
 
 	/** If true, the version control command succeeded*/
 	bool bCommandSuccessful;
@@ -76,18 +100,27 @@ public:
 	/** If true, this command will be automatically cleaned up in Tick() */
 	bool bAutoDelete;
 
+	/** Set on the game thread once the results were returned and the states updated */
+	bool bFinalized = false;
+
+	/** The provider's completion queue - the command pushes itself there once processed */
+	TQueue<FDiversionCommand*, EQueueMode::Mpsc>* CompletionQueue = nullptr;
+
+	/** Triggered once the command was pushed to the completion queue, wakes up a synchronous wait. Owned by the provider */
+	FEvent* CompletionEvent = nullptr;
+
 	/** Files to perform this operation on */
 	TArray<FString> Files;
 
+	/** File system state of the files, so the command stats each of them once */
+	mutable FDiversionStatCache StatCache;
+
 	/** Info and/or warning message storage*/
 	TArray<FString> InfoMessages;
 
 	/** Potential error message storage*/
 	TArray<FString> ErrorMessages;
 
-	/** Potential conflicted file paths to query again - used to know promptly if their state was resolved */
-	TArray<FString> ExistingPotentialConflicts;
-
 	/** Notification to show to the user as an Editor popup */
 	TUniquePtr<FDiversionNotification> PopupNotification;
 
@@ -95,6 +128,9 @@ private:
 	/** Perform the actual work of the command */
 	void DoWork();
 
+	/** Marks the command as processed and hands it to the game thread, only the first call has any effect */
+	void SignalCompletion();
+
 	/** All commands are running in a BG worker, this indicates if the caller wanted this to block game thread or not */
 	EConcurrency::Type Concurrency;
 };
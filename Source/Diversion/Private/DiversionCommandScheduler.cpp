@@ -0,0 +1,220 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "DiversionCommandScheduler.h"
+
+#include "DiversionCommand.h"
+#include "DiversionConstants.h"
+#include "IDiversionWorker.h"
+#include "Misc/QueuedThreadPool.h"
+
+#include <atomic>
+
+const TCHAR* EDiversionCommandLane::ToString(Type InLane)
+{
+	switch (InLane)
+	{
+	case Interactive:
+		return TEXT("Interactive");
+	case Background:
+		return TEXT("Background");
+	case Bulk:
+		return TEXT("Bulk");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+namespace
+{
+	std::atomic<int32> NumUsedStepSlots{0};
+}
+
+int32 DiversionCommandSteps::TryAcquireSlots(int32 InNum)
+{
+	if (InNum <= 0)
+	{
+		return 0;
+	}
+	int32 NumUsed = NumUsedStepSlots.load(std::memory_order_relaxed);
+	int32 NumTaken = 0;
+	do
+	{
+		NumTaken = FMath::Clamp(MAX_CONCURRENT_COMMAND_STEPS - NumUsed, 0, InNum);
+	}
+	while (NumTaken > 0 && !NumUsedStepSlots.compare_exchange_weak(NumUsed, NumUsed + NumTaken, std::memory_order_relaxed));
+	return NumTaken;
+}
+
+void DiversionCommandSteps::ReleaseSlots(int32 InNum)
+{
+	NumUsedStepSlots.fetch_sub(InNum, std::memory_order_relaxed);
+}
+
+/** Pool work item wrapping a command - the command itself may be deleted by the game thread as soon as it completes */
+class FDiversionCommandScheduler::FScheduledCommand final : public IQueuedWork
+{
+public:
+	FScheduledCommand(FDiversionCommandScheduler& InScheduler, FDiversionCommand& InCommand, EDiversionCommandLane::Type InLane)
+		: Scheduler(InScheduler)
+		, Command(InCommand)
+		, Lane(InLane)
+		, EnqueueTime(FPlatformTime::Seconds())
+	{
+	}
+
+	virtual void DoThreadedWork() override
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		// Don't touch the command after this point, it might already be deleted
+		Command.DoThreadedWork();
+		const double EndTime = FPlatformTime::Seconds();
+
+		Scheduler.OnCommandFinished(Lane, StartTime - EnqueueTime, EndTime - StartTime);
+		delete this;
+	}
+
+	virtual void Abandon() override
+	{
+		Command.Abandon();
+		delete this;
+	}
+
+private:
+	FDiversionCommandScheduler& Scheduler;
+	FDiversionCommand& Command;
+	const EDiversionCommandLane::Type Lane;
+	const double EnqueueTime;
+};
+
+FDiversionCommandScheduler::FDiversionCommandScheduler(int32 InNumThreads, int32 InMaxQueuedCommands)
+	// At least one thread for the interactive lane and one for the rest
+	: NumThreads(FMath::Max(InNumThreads, 2))
+	, MaxQueuedCommands(FMath::Max(InMaxQueuedCommands, 1))
+{
+	ThreadPool = FQueuedThreadPool::Allocate();
+	verify(ThreadPool->Create(NumThreads, 128 * 1024, TPri_Normal, TEXT("DiversionThreadPool")));
+}
+
+FDiversionCommandScheduler::~FDiversionCommandScheduler()
+{
+	AbandonQueued();
+	// Waits for the running commands to finish
+	ThreadPool->Destroy();
+	delete ThreadPool;
+	ThreadPool = nullptr;
+}
+
+bool FDiversionCommandScheduler::TryEnqueue(FDiversionCommand& InCommand, EDiversionCommandLane::Type InLane)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (bShuttingDown)
+	{
+		InCommand.Abandon();
+		return true;
+	}
+
+	// Interactive commands are never held back - the user is waiting for them
+	if (InLane != EDiversionCommandLane::Interactive && GetNumQueuedBoundedCommands() >= MaxQueuedCommands)
+	{
+		return false;
+	}
+
+	PendingCommands[InLane].Enqueue(new FScheduledCommand(*this, InCommand, InLane));
+	LaneStats[InLane].QueueDepth++;
+	DispatchPending();
+	return true;
+}
+
+void FDiversionCommandScheduler::AbandonQueued()
+{
+	FScopeLock ScopeLock(&Lock);
+	bShuttingDown = true;
+	for (TQueue<FScheduledCommand*>& LaneQueue : PendingCommands)
+	{
+		FScheduledCommand* ScheduledCommand = nullptr;
+		while (LaneQueue.Dequeue(ScheduledCommand))
+		{
+			ScheduledCommand->Abandon();
+		}
+	}
+	for (FDiversionCommandLaneStats& Stats : LaneStats)
+	{
+		Stats.QueueDepth = 0;
+	}
+}
+
+FDiversionCommandLaneStats FDiversionCommandScheduler::GetLaneStats(EDiversionCommandLane::Type InLane) const
+{
+	FScopeLock ScopeLock(&Lock);
+	return LaneStats[InLane];
+}
+
+int32 FDiversionCommandScheduler::GetLaneConcurrencyLimit(EDiversionCommandLane::Type InLane) const
+{
+	switch (InLane)
+	{
+	case EDiversionCommandLane::Interactive:
+		return NumThreads;
+	case EDiversionCommandLane::Background:
+		return NumThreads - 1;
+	case EDiversionCommandLane::Bulk:
+	default:
+		return FMath::Max(NumThreads / 2, 1);
+	}
+}
+
+void FDiversionCommandScheduler::DispatchPending()
+{
+	int32 NumInFlight = 0;
+	for (const FDiversionCommandLaneStats& Stats : LaneStats)
+	{
+		NumInFlight += Stats.InFlight;
+	}
+	// One thread is always kept for the interactive lane
+	int32 NumNonInteractiveInFlight = NumInFlight - LaneStats[EDiversionCommandLane::Interactive].InFlight;
+
+	for (int32 LaneIndex = 0; LaneIndex < EDiversionCommandLane::Num && NumInFlight < NumThreads; ++LaneIndex)
+	{
+		const EDiversionCommandLane::Type Lane = static_cast<EDiversionCommandLane::Type>(LaneIndex);
+		const bool bIsInteractive = Lane == EDiversionCommandLane::Interactive;
+		FDiversionCommandLaneStats& Stats = LaneStats[Lane];
+
+		FScheduledCommand* ScheduledCommand = nullptr;
+		while (NumInFlight < NumThreads
+			&& Stats.InFlight < GetLaneConcurrencyLimit(Lane)
+			&& (bIsInteractive || NumNonInteractiveInFlight < NumThreads - 1)
+			&& PendingCommands[Lane].Dequeue(ScheduledCommand))
+		{
+			Stats.QueueDepth--;
+			Stats.InFlight++;
+			NumInFlight++;
+			if (!bIsInteractive)
+			{
+				NumNonInteractiveInFlight++;
+			}
+			ThreadPool->AddQueuedWork(ScheduledCommand);
+		}
+	}
+}
+
+void FDiversionCommandScheduler::OnCommandFinished(EDiversionCommandLane::Type InLane, double WaitSeconds, double ExecutionSeconds)
+{
+	FScopeLock ScopeLock(&Lock);
+	FDiversionCommandLaneStats& Stats = LaneStats[InLane];
+	Stats.InFlight--;
+	Stats.Completed++;
+	Stats.TotalWaitSeconds += WaitSeconds;
+	Stats.MaxWaitSeconds = FMath::Max(Stats.MaxWaitSeconds, WaitSeconds);
+	Stats.TotalExecutionSeconds += ExecutionSeconds;
+	Stats.MaxExecutionSeconds = FMath::Max(Stats.MaxExecutionSeconds, ExecutionSeconds);
+
+	if (!bShuttingDown)
+	{
+		DispatchPending();
+	}
+}
+
+int32 FDiversionCommandScheduler::GetNumQueuedBoundedCommands() const
+{
+	return LaneStats[EDiversionCommandLane::Background].QueueDepth + LaneStats[EDiversionCommandLane::Bulk].QueueDepth;
+}
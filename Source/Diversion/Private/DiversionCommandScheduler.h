@@ -0,0 +1,125 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+
+class FDiversionCommand;
+class FQueuedThreadPool;
+
+namespace EDiversionCommandLane
+{
+	/** Priority lanes of the Diversion commands, in dispatch order */
+	enum Type : uint8
+	{
+		/** User facing operations (check in, revert, sync...) and anything the game thread waits for */
+		Interactive,
+		/** Periodic polls - status, clashes, conflicts, agent health */
+		Background,
+		/** Long running fetches that nobody waits for - history, analytics */
+		Bulk,
+
+		Num
+	};
+
+	const TCHAR* ToString(Type InLane);
+}
+
+/**
+ * Slots of the steps the commands run on the task workers next to their own thread (e.g. concurrent requests).
+ * The steps block on the network, so their number is capped across all the commands (MAX_CONCURRENT_COMMAND_STEPS).
+ * A command that doesn't get a slot runs the step on its own thread instead - a step never waits for a slot,
+ * so steps launching steps can't deadlock. Thread safe.
+ */
+namespace DiversionCommandSteps
+{
+	/** Takes up to InNum slots, returns the number taken */
+	int32 TryAcquireSlots(int32 InNum);
+
+	void ReleaseSlots(int32 InNum);
+}
+
+/** Counters of a single lane, see FDiversionCommandScheduler::GetLaneStats */
+struct FDiversionCommandLaneStats
+{
+	/** Commands waiting for a thread */
+	int32 QueueDepth = 0;
+	/** Commands currently running */
+	int32 InFlight = 0;
+	/** Commands that finished running */
+	uint64 Completed = 0;
+
+	/** Time spent between being issued and starting to run */
+	double TotalWaitSeconds = 0.0;
+	double MaxWaitSeconds = 0.0;
+
+	/** Time spent running on a worker thread */
+	double TotalExecutionSeconds = 0.0;
+	double MaxExecutionSeconds = 0.0;
+
+	double GetAverageWaitSeconds() const { return Completed > 0 ? TotalWaitSeconds / Completed : 0.0; }
+	double GetAverageExecutionSeconds() const { return Completed > 0 ? TotalExecutionSeconds / Completed : 0.0; }
+};
+
+/**
+ * Runs the Diversion commands on a dedicated thread pool, so they neither compete with
+ * GThreadPool users (shader compilation, asset loading) nor get rejected when it is busy.
+ *
+ * Commands are queued per lane and dispatched in lane priority order. Background and bulk
+ * lanes can never take all the threads, so an interactive command never waits behind polls
+ * or history fetches. The background and bulk queues are bounded - a command issued into a full
+ * queue is handed back to the caller, which holds on to it until a slot frees up. The caller is
+ * the game thread, so it's never blocked here.
+ */
+class FDiversionCommandScheduler
+{
+public:
+	FDiversionCommandScheduler(int32 InNumThreads, int32 InMaxQueuedCommands);
+	~FDiversionCommandScheduler();
+
+	FDiversionCommandScheduler(const FDiversionCommandScheduler&) = delete;
+	FDiversionCommandScheduler& operator=(const FDiversionCommandScheduler&) = delete;
+
+	/**
+	 * Queues the command on the given lane, never blocks.
+	 * @returns false without taking the command if the lane queues are full, never for the interactive lane
+	 */
+	bool TryEnqueue(FDiversionCommand& InCommand, EDiversionCommandLane::Type InLane);
+
+	/**
+	 * Abandons the queued commands that didn't start running, and any command enqueued from now on.
+	 * The running ones are left to finish - the destructor waits for them.
+	 */
+	void AbandonQueued();
+
+	FDiversionCommandLaneStats GetLaneStats(EDiversionCommandLane::Type InLane) const;
+
+	int32 GetNumThreads() const { return NumThreads; }
+
+private:
+	class FScheduledCommand;
+
+	/** Max number of commands of the lane allowed to run at the same time */
+	int32 GetLaneConcurrencyLimit(EDiversionCommandLane::Type InLane) const;
+
+	/** Hands queued commands to the pool while the lane limits allow. Must be called with Lock held */
+	void DispatchPending();
+
+	/** Called from the worker thread once a command is done running */
+	void OnCommandFinished(EDiversionCommandLane::Type InLane, double WaitSeconds, double ExecutionSeconds);
+
+	int32 GetNumQueuedBoundedCommands() const;
+
+private:
+	const int32 NumThreads;
+	const int32 MaxQueuedCommands;
+
+	FQueuedThreadPool* ThreadPool = nullptr;
+
+	mutable FCriticalSection Lock;
+	/** Queued commands per lane - only accessed with Lock held */
+	TQueue<FScheduledCommand*> PendingCommands[EDiversionCommandLane::Num];
+	FDiversionCommandLaneStats LaneStats[EDiversionCommandLane::Num];
+	bool bShuttingDown = false;
+};
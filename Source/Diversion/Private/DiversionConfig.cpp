@@ -12,3 +12,32 @@ bool IsDiversionSoftLockEnabled()
         return ConcertClientConfig->bEnableSoftLock;
 }
 
+int32 GetDiversionMaxCachedStates()
+{
+        return GetDefault<UDiversionConfig>()->MaxCachedStates;
+}
+
+int32 GetDiversionCommandThreads()
+{
+        return GetDefault<UDiversionConfig>()->CommandThreads;
+}
+
+double GetDiversionCommandCompletionBudgetSeconds()
+{
+        return GetDefault<UDiversionConfig>()->CommandCompletionBudgetMs / 1000.0;
+}
+
+int32 GetDiversionClashRequestParallelism()
+{
+        return GetDefault<UDiversionConfig>()->ClashRequestParallelism;
+}
+
+int64 GetDiversionMaxBlobCacheBytes()
+{
+        return static_cast<int64>(GetDefault<UDiversionConfig>()->MaxBlobCacheSizeMB) * 1024 * 1024;
+}
+
+int32 GetDiversionHistoryRequestParallelism()
+{
+        return GetDefault<UDiversionConfig>()->HistoryRequestParallelism;
+}
@@ -31,7 +31,66 @@ public:
                 DisplayName="Enable Diversion Auto Soft Lock Confirmations",
                 Tooltip="If unchecked, Diversion will not warn for potential conflicts before opening and saving files that have been modified in another branch or workspace"))
         bool bEnableSoftLock = true;
+
+        /**
+         * Maximum number of file states kept in memory. Unchanged states that weren't used recently are evicted above it.
+         */
+        UPROPERTY(config, EditAnywhere, Category="Performance", Meta=(ConfigRestartRequired=false, ClampMin=0,
+                DisplayName="Max Cached File States",
+                Tooltip="Clean file states that were not used recently are dropped from memory above this count. 0 disables the limit."))
+        int32 MaxCachedStates = 100000;
+
+        /**
+         * Number of threads running Diversion commands. One of them is always kept for interactive operations.
+         */
+        UPROPERTY(config, EditAnywhere, Category="Performance", Meta=(ConfigRestartRequired=true, ClampMin=2, ClampMax=32,
+                DisplayName="Command Threads",
+                Tooltip="Number of threads dedicated to Diversion commands. Requires an editor restart."))
+        int32 CommandThreads = 4;
+
+        /**
+         * Time per editor frame spent on applying the results of completed Diversion commands.
+         */
+        UPROPERTY(config, EditAnywhere, Category="Performance", Meta=(ConfigRestartRequired=false, ClampMin=0.1, Units="ms",
+                DisplayName="Command Completion Budget",
+                Tooltip="Time per editor frame spent on applying the results of completed Diversion commands. At least one command is always applied per frame."))
+        float CommandCompletionBudgetMs = 4.f;
+
+        /**
+         * Number of path prefix batches a potential clashes refresh requests concurrently.
+         */
+        UPROPERTY(config, EditAnywhere, Category="Performance", Meta=(ConfigRestartRequired=false, ClampMin=1, ClampMax=16,
+                DisplayName="Concurrent Clash Requests",
+                Tooltip="Number of requests a potential conflicts refresh sends at once. Large repositories are split in many of them."))
+        int32 ClashRequestParallelism = 4;
+
+        /**
+         * Disk space used by the file revisions downloaded for diffs, shared by identical content across commits.
+         */
+        UPROPERTY(config, EditAnywhere, Category="Performance", Meta=(ConfigRestartRequired=false, ClampMin=0, Units="MB",
+                DisplayName="Diff Blob Cache Size",
+                Tooltip="Disk space kept for file revisions downloaded for diffs. The least recently used ones are deleted above it. 0 disables the cache."))
+        int32 MaxBlobCacheSizeMB = 2048;
+
+        /**
+         * Number of file histories a history request fetches concurrently.
+         */
+        UPROPERTY(config, EditAnywhere, Category="Performance", Meta=(ConfigRestartRequired=false, ClampMin=1, ClampMax=32,
+                DisplayName="Concurrent History Requests",
+                Tooltip="Number of file histories fetched at once when showing the history of many files."))
+        int32 HistoryRequestParallelism = 8;
 };
 
 bool IsDiversionSoftLockEnabled();
 
+int32 GetDiversionMaxCachedStates();
+
+int32 GetDiversionCommandThreads();
+
+double GetDiversionCommandCompletionBudgetSeconds();
+
+int32 GetDiversionClashRequestParallelism();
+
+int64 GetDiversionMaxBlobCacheBytes();
+
+int32 GetDiversionHistoryRequestParallelism();
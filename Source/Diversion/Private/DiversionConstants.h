@@ -7,6 +7,56 @@
 constexpr float	SECONDS_TO_POLL_STATUS = 5.f;
 constexpr float SECONDS_TO_POLL_POTENTIAL_CLASHES = 60.f;
 constexpr float SECONDS_TO_POLL_CONFLICTED_FILES = 20.f;
+// An asset opened again within this window doesn't refresh its status and potential clashes again
+constexpr double SECONDS_OPENED_ASSET_REFRESH_WINDOW = 30.0;
+
+// Polls that found nothing new double their interval, up to this factor of the intervals above
+constexpr float POLL_MAX_BACKOFF_FACTOR = 8.f;
+// Random spread of the polling intervals, so editors started together don't poll in lockstep
+constexpr float POLL_INTERVAL_JITTER = 0.1f;
+// Max delay of a poll that came due while the editor was unfocused, once it's focused again
+constexpr float SECONDS_MAX_POLL_RESUME_DELAY = 2.f;
+
+// Changed files collected by the directory watcher before the background status falls back to a full workspace scan
+constexpr int32 MAX_WATCHED_DIRTY_PATHS = 1000;
+// Full workspace scans still run this often, catching changes outside of the watched project directories
+constexpr double SECONDS_BETWEEN_FULL_STATUS = 120.0;
+
+// Max time the agent holds a workspace events request open while there are no events
+constexpr int32 SECONDS_AGENT_EVENTS_LONG_POLL = 25;
+// Delay before subscribing to the agent events again after a failed request
+constexpr float SECONDS_AGENT_EVENTS_RETRY = 5.f;
+
+// Max number of background and bulk commands waiting for a thread, more are held on the game thread until there is room
+constexpr int32 MAX_QUEUED_BACKGROUND_COMMANDS = 128;
+// Max time a synchronous command waits for a completion before ticking its progress dialog again
+constexpr uint32 MILLISECONDS_SYNCHRONOUS_COMMAND_PROGRESS_TICK = 50;
+
+// Max number of requests a single command runs concurrently (e.g. history of many files)
+constexpr int32 MAX_PARALLEL_COMMAND_STEPS = 4;
+// Max number of blocking steps running on the task workers at once, across all the commands
+constexpr int32 MAX_CONCURRENT_COMMAND_STEPS = 8;
+// Commands with fewer paths stat them on their own thread instead of in parallel
+constexpr int32 MIN_PARALLEL_STAT_PATHS = 64;
+
+// Revisions requested at first for a file whose history is cached, enough to reach the cached newest commit most of the time
+constexpr int32 HISTORY_INCREMENTAL_PAGE_SIZE = 10;
+// Files kept in the history cache
+constexpr int32 MAX_HISTORY_CACHE_FILES = 2000;
+// Longer histories aren't cached, they're fetched whole every time
+constexpr int32 MAX_CACHED_HISTORY_REVISIONS = 1000;
+
+// States accessed within this window are never evicted from the state cache
+constexpr float SECONDS_STATE_CACHE_MIN_IDLE = 60.f;
+constexpr float SECONDS_BETWEEN_STATE_CACHE_EVICTIONS = 5.f;
+// Fraction of the cap the state cache is trimmed down to on eviction
+constexpr float STATE_CACHE_EVICTION_LOW_WATERMARK = 0.9f;
+// Max states an eviction pass looks at, the next pass carries on from where it stopped
+constexpr int32 STATE_CACHE_EVICTION_SCAN_LIMIT = 20000;
+// Fraction of the configured size the diff blob cache is trimmed down to on eviction
+constexpr float BLOB_CACHE_EVICTION_LOW_WATERMARK = 0.8f;
+// Chunk the diff blob cache copies and digests its blobs by
+constexpr int64 BLOB_CACHE_COPY_CHUNK_SIZE = 1024 * 1024;
 
 #define DIVERSION_APP_URL "diversion://"
 #define DIVERSION_WEB_URL "https://app.diversion.dev/"
\ No newline at end of file
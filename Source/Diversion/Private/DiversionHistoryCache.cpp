@@ -0,0 +1,238 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "DiversionHistoryCache.h"
+
+#include "ISourceControlModule.h"
+#include "DiversionConstants.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 HistoryCacheFileMagic = 0x44564843; // "DVHC"
+	// Bump when the layout below changes, older files are then discarded
+	constexpr uint32 HistoryCacheFileVersion = 3;
+
+	FString GetHistoryCacheFilePath(const FString& WorkspaceID)
+	{
+		return FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("Diversion") / FString::Printf(TEXT("HistoryCache-%s.bin"), *WorkspaceID));
+	}
+
+	void SerializeRevision(FArchive& Ar, FDiversionRevision& Revision)
+	{
+		Ar << Revision.Filename;
+		Ar << Revision.CommitId;
+		Ar << Revision.ShortCommitId;
+		Ar << Revision.CommitIdNumber;
+		Ar << Revision.RevisionNumber;
+		Ar << Revision.FileHash;
+		Ar << Revision.Description;
+		Ar << Revision.UserName;
+		Ar << Revision.Action;
+		Ar << Revision.Date;
+		Ar << Revision.FileSize;
+	}
+}
+
+bool FDiversionHistoryCache::Find(const WorkspaceInfo& InWsInfo, const FString& InFile, TDiversionHistory& OutHistory)
+{
+	FScopeLock Lock(&EntriesLock);
+	LoadWorkspace(InWsInfo);
+	FEntry* Entry = Entries.Find(InFile);
+	if (Entry == nullptr || Entry->History.IsEmpty())
+	{
+		return false;
+	}
+	Entry->LastAccess = FPlatformTime::Seconds();
+	OutHistory = Entry->History;
+	return true;
+}
+
+void FDiversionHistoryCache::Update(const WorkspaceInfo& InWsInfo, const FString& InFile, const TDiversionHistory& InHistory)
+{
+	FScopeLock Lock(&EntriesLock);
+	LoadWorkspace(InWsInfo);
+	if (InHistory.Num() > MAX_CACHED_HISTORY_REVISIONS)
+	{
+		// A truncated history would look complete when merged with the newest revisions
+		bDirty |= Entries.Remove(InFile) > 0;
+		return;
+	}
+	FEntry& Entry = Entries.FindOrAdd(InFile);
+	Entry.History = InHistory;
+	Entry.LastAccess = FPlatformTime::Seconds();
+	bDirty = true;
+	if (Entries.Num() > MAX_HISTORY_CACHE_FILES)
+	{
+		Trim();
+	}
+}
+
+void FDiversionHistoryCache::Save()
+{
+	FScopeLock Lock(&EntriesLock);
+	SaveLoaded();
+}
+
+bool FDiversionHistoryCache::MergeNewest(const TDiversionHistory& InCached, const TDiversionHistory& InNewest, TDiversionHistory& OutHistory)
+{
+	if (InCached.IsEmpty())
+	{
+		return false;
+	}
+	const FString& CachedHeadCommitId = InCached[0]->CommitId;
+	const int32 NumNewRevisions = InNewest.IndexOfByPredicate([&CachedHeadCommitId](const TSharedRef<FDiversionRevision, ESPMode::ThreadSafe>& Revision) {
+		return Revision->CommitId == CachedHeadCommitId;
+	});
+	if (NumNewRevisions == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutHistory.Reset(NumNewRevisions + InCached.Num());
+	OutHistory.Append(InNewest.GetData(), NumNewRevisions);
+	OutHistory.Append(InCached);
+	return true;
+}
+
+void FDiversionHistoryCache::LoadWorkspace(const WorkspaceInfo& InWsInfo)
+{
+	if (LoadedWsInfo.WorkspaceID == InWsInfo.WorkspaceID && LoadedWsInfo.RepoID == InWsInfo.RepoID)
+	{
+		return;
+	}
+
+	SaveLoaded();
+	Entries.Empty();
+	LoadedWsInfo = InWsInfo;
+	if (!InWsInfo.IsValid())
+	{
+		return;
+	}
+
+	const FString FilePath = GetHistoryCacheFilePath(InWsInfo.WorkspaceID);
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FilePath, FILEREAD_Silent))
+	{
+		return;
+	}
+
+	FMemoryReader Reader(Bytes);
+	// Guard the reads against corrupted counts/string lengths
+	Reader.ArMaxSerializeSize = Bytes.Num();
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	FString WorkspaceID;
+	FString RepoID;
+	Reader << Magic << Version;
+	if (!Reader.IsError() && Magic == HistoryCacheFileMagic && Version == HistoryCacheFileVersion)
+	{
+		Reader << WorkspaceID << RepoID;
+	}
+	if (Reader.IsError() || WorkspaceID != InWsInfo.WorkspaceID || RepoID != InWsInfo.RepoID)
+	{
+		UE_LOG(LogSourceControl, Log, TEXT("Discarding outdated Diversion history cache %s"), *FilePath);
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+		return;
+	}
+
+	int32 NumFiles = 0;
+	Reader << NumFiles;
+	for (int32 FileIndex = 0; FileIndex < NumFiles && !Reader.IsError(); ++FileIndex)
+	{
+		FString File;
+		int32 NumRevisions = 0;
+		Reader << File << NumRevisions;
+		FEntry& Entry = Entries.Add(File);
+		for (int32 RevisionIndex = 0; RevisionIndex < NumRevisions && !Reader.IsError(); ++RevisionIndex)
+		{
+			TSharedRef<FDiversionRevision, ESPMode::ThreadSafe> Revision = MakeShared<FDiversionRevision>();
+			SerializeRevision(Reader, *Revision);
+			// Revisions download their content through the workspace they were fetched with
+			Revision->WsInfo = InWsInfo;
+			Entry.History.Add(MoveTemp(Revision));
+		}
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogSourceControl, Log, TEXT("Discarding corrupted Diversion history cache %s"), *FilePath);
+		Entries.Empty();
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+		return;
+	}
+	UE_LOG(LogSourceControl, Log, TEXT("Loaded the history of %d files from the Diversion history cache"), Entries.Num());
+}
+
+void FDiversionHistoryCache::SaveLoaded()
+{
+	if (!bDirty || !LoadedWsInfo.IsValid())
+	{
+		return;
+	}
+	bDirty = false;
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	uint32 Magic = HistoryCacheFileMagic;
+	uint32 Version = HistoryCacheFileVersion;
+	FString WorkspaceID = LoadedWsInfo.WorkspaceID;
+	FString RepoID = LoadedWsInfo.RepoID;
+	Writer << Magic << Version << WorkspaceID << RepoID;
+
+	int32 NumFiles = Entries.Num();
+	Writer << NumFiles;
+	for (const auto& [Path, Entry] : Entries)
+	{
+		FString File = Path;
+		int32 NumRevisions = Entry.History.Num();
+		Writer << File << NumRevisions;
+		for (const TSharedRef<FDiversionRevision, ESPMode::ThreadSafe>& Revision : Entry.History)
+		{
+			FDiversionRevision RevisionCopy = *Revision;
+			SerializeRevision(Writer, RevisionCopy);
+		}
+	}
+
+	// Write to a temp file first so a crash mid-write never leaves a truncated cache behind
+	const FString FilePath = GetHistoryCacheFilePath(LoadedWsInfo.WorkspaceID);
+	const FString TempFilePath = FilePath + TEXT(".tmp");
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempFilePath))
+	{
+		UE_LOG(LogSourceControl, Warning, TEXT("Failed writing the Diversion history cache to %s"), *TempFilePath);
+		return;
+	}
+	PlatformFile.DeleteFile(*FilePath);
+	if (!PlatformFile.MoveFile(*FilePath, *TempFilePath))
+	{
+		UE_LOG(LogSourceControl, Warning, TEXT("Failed moving the Diversion history cache to %s"), *FilePath);
+		PlatformFile.DeleteFile(*TempFilePath);
+		return;
+	}
+
+	UE_LOG(LogSourceControl, Verbose, TEXT("Saved the history of %d files to the Diversion history cache %s"), Entries.Num(), *FilePath);
+}
+
+void FDiversionHistoryCache::Trim()
+{
+	TArray<TPair<double, FString>> ByAccess;
+	ByAccess.Reserve(Entries.Num());
+	for (const auto& [Path, Entry] : Entries)
+	{
+		ByAccess.Emplace(Entry.LastAccess, Path);
+	}
+	ByAccess.Sort([](const TPair<double, FString>& A, const TPair<double, FString>& B) {
+		return A.Key < B.Key;
+	});
+
+	const int32 NumToRemove = Entries.Num() - MAX_HISTORY_CACHE_FILES;
+	for (int32 Index = 0; Index < NumToRemove; ++Index)
+	{
+		Entries.Remove(ByAccess[Index].Value);
+	}
+}
@@ -0,0 +1,62 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "DiversionRevision.h"
+#include "DiversionWorkspaceInfo.h"
+
+/**
+ * Histories of the files of the current workspace, so showing a history again only fetches the commits
+ * newer than the cached one. Persisted between editor sessions, under the project Saved directory.
+ * Thread safe, histories are fetched from the command threads.
+ */
+class FDiversionHistoryCache
+{
+public:
+	/**
+	 * The cached history of a file, newest revision first - its first revision is the newest commit known for the file.
+	 * @returns false if the history of the file isn't cached
+	 */
+	bool Find(const WorkspaceInfo& InWsInfo, const FString& InFile, TDiversionHistory& OutHistory);
+
+	/** Replaces the cached history of a file. Histories above MAX_CACHED_HISTORY_REVISIONS are dropped instead, never cached partially */
+	void Update(const WorkspaceInfo& InWsInfo, const FString& InFile, const TDiversionHistory& InHistory);
+
+	/** Writes the histories of the loaded workspace to disk, if they changed */
+	void Save();
+
+	/**
+	 * Prepends the revisions newer than the cached ones to a cached history.
+	 * @param InNewest The newest revisions of the file, newest first - the first page of its history
+	 * @returns false if the newest cached revision isn't part of InNewest - more new commits than the page holds,
+	 * or the cached revisions aren't part of the history anymore (e.g. the workspace switched branches) - the whole history has to be fetched
+	 */
+	static bool MergeNewest(const TDiversionHistory& InCached, const TDiversionHistory& InNewest, TDiversionHistory& OutHistory);
+
+private:
+	struct FEntry
+	{
+		TDiversionHistory History;
+		/** FPlatformTime::Seconds of the last lookup, the least recently used files are dropped above MAX_HISTORY_CACHE_FILES */
+		double LastAccess = 0.0;
+	};
+
+	/** Swaps the loaded histories for the ones of the given workspace. Requires the lock */
+	void LoadWorkspace(const WorkspaceInfo& InWsInfo);
+
+	/** Writes the loaded histories to disk, if they changed. Requires the lock */
+	void SaveLoaded();
+
+	/** Drops the least recently used histories above MAX_HISTORY_CACHE_FILES. Requires the lock */
+	void Trim();
+
+private:
+	FCriticalSection EntriesLock;
+	/** The workspace Entries belong to */
+	WorkspaceInfo LoadedWsInfo;
+	TMap<FString, FEntry> Entries;
+	/** Entries changed since they were loaded or saved */
+	bool bDirty = false;
+};
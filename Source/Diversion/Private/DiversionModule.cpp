@@ -13,7 +13,9 @@
 #include "CustomWidgets/ConfirmationDialog.h"
 
 #include "AssetToolsModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
 #include "SourceControlOperations.h"
+#include "DiversionConstants.h"
 
 // Enable plugin config
 #include "ISettingsModule.h"
@@ -156,6 +158,12 @@ FString FDiversionModule::GetAccessToken(FString InUserID) {
 
 void FDiversionModule::HandleAssetOpenedInEditor(UObject* Asset)
 {
+	if (Asset != nullptr)
+	{
+		// The asset's own clashes are fetched below when soft lock is on
+		RefreshOpenedAssetStates(Asset, !IsDiversionSoftLockEnabled());
+	}
+
 	if(!IsDiversionSoftLockEnabled())
 	{
 		// The user disabled this feature
@@ -215,6 +223,65 @@ void FDiversionModule::HandleAssetOpenedInEditor(UObject* Asset)
 	ShowPotentialConflictConfirmationDialog(Asset);
 }
 
+void FDiversionModule::RefreshOpenedAssetStates(UObject* Asset, bool bIncludeAssetClashes)
+{
+	if (!ISourceControlModule::Get().IsEnabled() || &ISourceControlModule::Get().GetProvider() != &DiversionProvider ||
+		!DiversionProvider.IsAvailable()) {
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	for (auto It = RefreshedOpenedAssets.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value() > SECONDS_OPENED_ASSET_REFRESH_WINDOW)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	// Opening an asset often opens it again right away (e.g. as read only), or opens it in several editors
+	const FName PackageName = Asset->GetOutermost()->GetFName();
+	if (RefreshedOpenedAssets.Contains(PackageName))
+	{
+		return;
+	}
+	RefreshedOpenedAssets.Add(PackageName, Now);
+
+	const FString AssetFilePath = FPaths::ConvertRelativePathToFull(DiversionUtils::GetFilePathFromAssetData(FAssetData(Asset)));
+	if (AssetFilePath.IsEmpty())
+	{
+		return;
+	}
+
+	// The packages the asset references are saved along with it when they were modified from its editor
+	TArray<FName> Dependencies;
+	IAssetRegistry::GetChecked().GetDependencies(PackageName, Dependencies, UE::AssetRegistry::EDependencyCategory::Package);
+	TArray<FString> DependencyFilePaths;
+	for (const FName& Dependency : Dependencies)
+	{
+		FString DependencyFilePath;
+		if (!FPackageName::IsScriptPackage(Dependency.ToString()) &&
+			FPackageName::DoesPackageExist(Dependency.ToString(), &DependencyFilePath))
+		{
+			DependencyFilePaths.Add(FPaths::ConvertRelativePathToFull(DependencyFilePath));
+		}
+	}
+
+	TArray<FString> StatusFilePaths = DependencyFilePaths;
+	StatusFilePaths.Add(AssetFilePath);
+	TArray<FString> ClashesFilePaths = DependencyFilePaths;
+	if (bIncludeAssetClashes)
+	{
+		ClashesFilePaths.Add(AssetFilePath);
+	}
+
+	// Targeted requests run on the interactive lane, ahead of the background polls
+	DiversionProvider.Execute(ISourceControlOperation::Create<FUpdateStatus>(), nullptr, StatusFilePaths, EConcurrency::Asynchronous);
+	if (!ClashesFilePaths.IsEmpty())
+	{
+		DiversionProvider.Execute(ISourceControlOperation::Create<FGetPotentialClashes>(), nullptr, ClashesFilePaths, EConcurrency::Asynchronous);
+	}
+}
+
 bool FDiversionModule::PotentialConflictExistForAsset(UObject* Asset)
 {
 	ISourceControlProvider& SourceControlProvider = ISourceControlModule::Get().GetProvider();
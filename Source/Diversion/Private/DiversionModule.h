@@ -6,6 +6,8 @@
 #include "DiversionSettings.h"
 #include "DiversionProvider.h"
 #include "DiversionUtils.h"
+#include "DiversionBlobCache.h"
+#include "DiversionHistoryCache.h"
 
 #include "ISourceControlModule.h"
 #include "DiversionCredentialsManager.h"
@@ -46,6 +48,18 @@ public:
 		return DiversionProvider;
 	}
 
+	/** Access the blobs downloaded for diffs, from any thread */
+	FDiversionBlobCache& GetBlobCache()
+	{
+		return BlobCache;
+	}
+
+	/** Access the cached file histories, from any thread */
+	FDiversionHistoryCache& GetHistoryCache()
+	{
+		return HistoryCache;
+	}
+
 	/**
 	 * Singleton-like access to this module's interface.  This is just for convenience!
 	 * Beware of calling this during the shutdown phase, though.  Your module might have been unloaded already.
@@ -89,6 +103,12 @@ public:
 private:
 	/** Event handler for asset editor window opening */
 	void HandleAssetOpenedInEditor(UObject* Asset);
+	/**
+	 * Refreshes the status and potential clashes of an opened asset and of its dependencies right away,
+	 * instead of waiting for the background polls - the user is likely to save them soon.
+	 * @param bIncludeAssetClashes false if the potential clashes of the asset itself are already being fetched
+	 */
+	void RefreshOpenedAssetStates(UObject* Asset, bool bIncludeAssetClashes);
 	bool PotentialConflictExistForAsset(UObject* Asset);
 	void ShowPotentialConflictConfirmationDialog(UObject* Asset);
 	
@@ -97,6 +117,9 @@ private:
 	**/
 	TSet<FString> OpenedEditorAssets;
 
+	/** Packages refreshed by RefreshOpenedAssetStates, with the time (FPlatformTime::Seconds) they were */
+	TMap<FName, double> RefreshedOpenedAssets;
+
 private:
 	/** The Diversion version control provider */
 	FDiversionProvider DiversionProvider;
@@ -104,6 +127,12 @@ private:
 	/** The settings for Diversion version control */
 	FDiversionSettings DiversionSettings;
 
+	/** Content addressed cache of the file revisions downloaded for diffs */
+	FDiversionBlobCache BlobCache;
+
+	/** Histories of the files of the current workspace, persisted between sessions */
+	FDiversionHistoryCache HistoryCache;
+
 	FCredentialsManager CredManager;
 
 	// Storing long-lived APICalls
@@ -6,6 +6,11 @@
 #include "DiversionModule.h"
 #include "DiversionProvider.h"
 #include "DiversionUtils.h"
+#include "DiversionConstants.h"
+#include "Tasks/Task.h"
+
+#include <atomic>
+
 #if PLATFORM_WINDOWS
 #include "Windows/AllowWindowsPlatformTypes.h"
 #endif
@@ -28,6 +33,108 @@ bool ExecuteValidityCheck(FDiversionCommand& InCommand, const FName& WorkerName)
 	return true;
 }
 
+namespace
+{
+	/** Messages of a step running concurrently with other steps - added to the command once the steps are done */
+	struct FStepMessages
+	{
+		TArray<FString> InfoMessages;
+		TArray<FString> ErrorMessages;
+
+		void AppendTo(FDiversionCommand& InCommand)
+		{
+			InCommand.InfoMessages.Append(MoveTemp(InfoMessages));
+			InCommand.ErrorMessages.Append(MoveTemp(ErrorMessages));
+		}
+	};
+
+	/**
+	 * An independent step of a worker, its result is collected with GetResult().
+	 * Runs as a task if a step slot is free, otherwise on the command thread once the result is asked for.
+	 */
+	class FStep
+	{
+	public:
+		template<typename StepType>
+		explicit FStep(StepType&& Step)
+		{
+			if (DiversionCommandSteps::TryAcquireSlots(1) == 1)
+			{
+				// The steps block on network requests, keep them off the foreground workers
+				Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Step = Forward<StepType>(Step)]() mutable
+				{
+					const bool bResult = Step();
+					DiversionCommandSteps::ReleaseSlots(1);
+					return bResult;
+				}, UE::Tasks::ETaskPriority::BackgroundNormal);
+			}
+			else
+			{
+				DeferredStep = Forward<StepType>(Step);
+			}
+		}
+
+		bool GetResult()
+		{
+			return Task.IsValid() ? Task.GetResult() : DeferredStep();
+		}
+
+	private:
+		UE::Tasks::TTask<bool> Task;
+		TUniqueFunction<bool()> DeferredStep;
+	};
+
+	/**
+	 * Runs the step on every item, on the command thread and up to InMaxParallelSteps - 1 tasks as step slots allow.
+	 * Returns once all are done.
+	 * Each thread takes the next item when it's done with one, and the messages are appended in the order of the items.
+	 * The step may write its results into the items of a non const array, each item is only ever used by one step.
+	 * @returns true if the step succeeded on every item
+	 */
+	template<typename ArrayType, typename StepType>
+	bool RunStepForEach(ArrayType& InItems, FStepMessages& OutMessages, const StepType& Step,
+		int32 InMaxParallelSteps = MAX_PARALLEL_COMMAND_STEPS)
+	{
+		TArray<FStepMessages> ItemsMessages;
+		ItemsMessages.SetNum(InItems.Num());
+		std::atomic<int32> NextItem{0};
+		auto RunItems = [&InItems, &Step, &ItemsMessages, &NextItem]()
+		{
+			bool bSuccess = true;
+			for (int32 ItemIndex = NextItem++; ItemIndex < InItems.Num(); ItemIndex = NextItem++)
+			{
+				bSuccess &= Step(InItems[ItemIndex], ItemsMessages[ItemIndex]);
+			}
+			return bSuccess;
+		};
+
+		const int32 NumHelperTasks = DiversionCommandSteps::TryAcquireSlots(FMath::Min(InItems.Num(), FMath::Max(InMaxParallelSteps, 1)) - 1);
+		TArray<UE::Tasks::TTask<bool>> Tasks;
+		for (int32 TaskIndex = 0; TaskIndex < NumHelperTasks; ++TaskIndex)
+		{
+			Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [&RunItems]()
+			{
+				const bool bResult = RunItems();
+				DiversionCommandSteps::ReleaseSlots(1);
+				return bResult;
+			}, UE::Tasks::ETaskPriority::BackgroundNormal));
+		}
+
+		// This thread runs a share of the items as well
+		bool bSuccess = RunItems();
+		for (UE::Tasks::TTask<bool>& Task : Tasks)
+		{
+			bSuccess &= Task.GetResult();
+		}
+		for (FStepMessages& ItemMessages : ItemsMessages)
+		{
+			OutMessages.InfoMessages.Append(MoveTemp(ItemMessages.InfoMessages));
+			OutMessages.ErrorMessages.Append(MoveTemp(ItemMessages.ErrorMessages));
+		}
+		return bSuccess;
+	}
+}
+
 FText FAgentHealthCheck::ProgressString = FText::GetEmpty();
 
 FText FGetWsInfo::ProgressString = FText::GetEmpty();
@@ -190,12 +297,24 @@ FName FDiversionGetPotentialClashes::GetName() const
 	return "GetPotentialClashes";
 }
 
+EDiversionCommandLane::Type FDiversionGetPotentialClashes::GetLane(const FDiversionCommand& InCommand) const
+{
+	// The periodic repo wide clashes poll
+	if (InCommand.Files.Contains(InCommand.WsInfo.GetPath()))
+	{
+		return EDiversionCommandLane::Background;
+	}
+	// Targeted requests for files the user is working on (e.g. an opened asset)
+	return EDiversionCommandLane::Interactive;
+}
+
 bool FDiversionGetPotentialClashes::Execute(class FDiversionCommand& InCommand)
 {
 	if(!ExecuteValidityCheck(InCommand, GetName())) { return false;}
 	
+	const TSharedRef<FGetPotentialClashes, ESPMode::ThreadSafe> Operation = StaticCastSharedRef<FGetPotentialClashes>(InCommand.Operation);
 	bool Success = DiversionUtils::GetPotentialFileClashes(InCommand, InCommand.InfoMessages,
-		InCommand.ErrorMessages, PotentialClashes, bRecursiveRequest);
+		InCommand.ErrorMessages, PotentialClashes, bRecursiveRequest, MaxParallelRequests, &Operation->IsCancelled());
 	if(Success)
 	{
 		QueriedPaths = InCommand.Files;
@@ -469,6 +588,7 @@ bool FDiversionCheckInWorker::UpdateStates() const
 		if (State->IsDeleted())
 		{
 			Provider.RemoveFileFromCache(State->GetFilename());
+			Provider.MarkStatesChanged();
 		}
 	}
 
@@ -536,10 +656,18 @@ bool FDiversionRevertWorker::Execute(FDiversionCommand& InCommand)
 	// Status will be updated in the BG by the provider
 	Success &= DiversionUtils::RunReset(InCommand, InCommand.InfoMessages, InCommand.ErrorMessages);
 	Success &= DiversionUtils::NotifyAgentSyncRequired(InCommand, InCommand.InfoMessages, InCommand.ErrorMessages);
+
+	// The status and the potential clashes only depend on the reset, fetch them concurrently
+	FStepMessages ClashesMessages;
+	FStep ClashesStep([this, &InCommand, &ClashesMessages]()
+	{
+		bool temptyReturnContainer;
+		return DiversionUtils::GetPotentialFileClashes(InCommand, ClashesMessages.InfoMessages,
+			ClashesMessages.ErrorMessages, PotentialClashes, temptyReturnContainer, MaxParallelClashRequests);
+	});
 	Success &= DiversionUtils::RunUpdateStatus(InCommand, InCommand.InfoMessages, InCommand.ErrorMessages);
-	bool temptyReturnContainer;
-	Success &= DiversionUtils::GetPotentialFileClashes(InCommand, InCommand.InfoMessages,
-		InCommand.ErrorMessages, PotentialClashes, temptyReturnContainer);
+	Success &= ClashesStep.GetResult();
+	ClashesMessages.AppendTo(InCommand);
 	
 	bShouldUpdateStates = Success;
 	
@@ -574,6 +702,21 @@ FName FDiversionUpdateStatusWorker::GetName() const
 	return "UpdateStatus";
 }
 
+EDiversionCommandLane::Type FDiversionUpdateStatusWorker::GetLane(const FDiversionCommand& InCommand) const
+{
+	const TSharedRef<FUpdateStatus, ESPMode::ThreadSafe> Operation = StaticCastSharedRef<FUpdateStatus>(InCommand.Operation);
+	if (Operation->ShouldUpdateHistory())
+	{
+		return EDiversionCommandLane::Bulk;
+	}
+	// The periodic repo wide status poll
+	if (InCommand.Files.Contains(InCommand.WsInfo.GetPath()))
+	{
+		return EDiversionCommandLane::Background;
+	}
+	return EDiversionCommandLane::Interactive;
+}
+
 bool FDiversionUpdateStatusWorker::Execute(FDiversionCommand& InCommand)
 {
 	if(!ExecuteValidityCheck(InCommand, GetName())) { return false;}
@@ -615,7 +758,7 @@ bool FDiversionUpdateStatusWorker::Execute(FDiversionCommand& InCommand)
 		}
 		// Call update status normally
 		QueriedPaths = InCommand.Files;
-		Success &= DiversionUtils::RunUpdateStatus(InCommand, InCommand.InfoMessages, InCommand.ErrorMessages, false);
+		Success &= DiversionUtils::RunUpdateStatus(InCommand, InCommand.InfoMessages, InCommand.ErrorMessages, false, true);
 		bShouldUpdateStates = Success;
 	}
 	
@@ -657,7 +800,12 @@ bool FDiversionUpdateStatusWorker::UpdateStates() const
 	for (const auto& History : Histories)
 	{
 		const TSharedRef<FDiversionState> State = Provider.GetStateInternal(History.Key);
-		State->History = History.Value;
+		State->SetHistory(History.Value);
+	}
+	if (!Histories.IsEmpty())
+	{
+		// The history views are refreshed by the broadcast, even if the working copy states didn't change
+		Provider.MarkStatesChanged();
 	}
 	
 	// If we ran get history, we should update the conflicted files as we fetched them implicitly
@@ -687,42 +835,127 @@ bool FDiversionUpdateStatusWorker::UpdateStates() const
 	}
 
 	// Async status call
-	if(bShouldUpdateStates)
+	bool bStatesChanged = !Histories.IsEmpty();
+	if(bShouldUpdateStates && bStatusUnchanged && Provider.GetSnapshot()->StatusFingerprint != StatusFingerprint)
+	{
+		// Compared with the snapshot the command was issued with, the cache changed since and the states weren't parsed
+		Provider.BackgroundStatusTriggerInstantCall();
+	}
+	else if(bShouldUpdateStates && bStatusUnchanged)
 	{
-		Provider.UpdateCachedStates(States, FullRepoUpdateRequested);
+		// Same status as the last applied one - nothing to update nor to broadcast
+		if(FullRepoUpdateRequested)
+		{
+			Provider.BackgroundStatusReportPollResult(false);
+		}
+	}
+	else if(bShouldUpdateStates)
+	{
+		bStatesChanged |= Provider.UpdateCachedStates(States, FullRepoUpdateRequested);
+		if(FullRepoUpdateRequested)
+		{
+			Provider.SetStatusFingerprint(StatusFingerprint);
+		}
 	}
 	else
 	{
 		UE_LOG(LogSourceControl, Warning, TEXT("Diversion: Issue when updating file statuses"));
 	}
 	
-	return true;
+	return bStatesChanged;
 }
 
 bool FDiversionUpdateStatusWorker::UpdateHistory(FDiversionCommand& InCommand)
 {
+	// The conflicts don't depend on the status, fetch them meanwhile
+	FStepMessages ConflictsMessages;
+	FStep ConflictsStep([this, &InCommand, &ConflictsMessages]()
+	{
+		return DiversionUtils::GetConflictedFiles(InCommand, ConflictsMessages.InfoMessages,
+			ConflictsMessages.ErrorMessages, ConflictedFilesData,
+			WorkspaceMergesList, BranchMergesList);
+	});
+
 	// When fetching history, we need to have the updated states data. so running update status first
 	bool Success = DiversionUtils::RunUpdateStatus(InCommand, InCommand.InfoMessages, InCommand.ErrorMessages);
 
-	bShouldUpdateConflicts = DiversionUtils::GetConflictedFiles(InCommand, InCommand.InfoMessages,
-		InCommand.ErrorMessages, ConflictedFilesData,
-		WorkspaceMergesList, BranchMergesList);
-	bShouldUpdateConflicts &= (ConflictedFilesData.Num() > 0);
+	// Get the history of the files in the current branch.
+	// Each file gets its own slot, so the histories are merged in the original order whichever completes first
+	struct FFileHistoryRequest
+	{
+		FString File;
+		/** The ref of the revision a conflict is with, the workspace if empty */
+		FString MergeFromRef;
+		bool bSuccess = false;
+		FString FilePath;
+		TDiversionHistory History;
+	};
+	auto RunHistoryRequest = [&InCommand](FFileHistoryRequest& Request, FStepMessages& OutMessages)
+	{
+		Request.bSuccess = DiversionUtils::RunGetHistory(InCommand, OutMessages.InfoMessages, OutMessages.ErrorMessages,
+			Request.File, Request.MergeFromRef.IsEmpty() ? nullptr : &Request.MergeFromRef, Request.FilePath, Request.History);
+		if (!Request.bSuccess)
+		{
+			OutMessages.ErrorMessages.Add(FString::Printf(TEXT("Failed fetching the history of %s"), *Request.File));
+		}
+		return Request.bSuccess;
+	};
 
-	// TODO: optimize this like plastic implementation
-	for (auto& State : States)
+	TArray<FFileHistoryRequest> HistoryRequests;
+	for (const auto& [FilePath, State] : States)
 	{
-		// Get the history of the file in the current branch
-		Success &= DiversionUtils::RunGetHistory(InCommand, InCommand.InfoMessages, InCommand.ErrorMessages, State.Key, nullptr);
+		HistoryRequests.AddDefaulted_GetRef().File = FilePath;
 	}
+	FStepMessages HistoryMessages;
+	RunStepForEach(HistoryRequests, HistoryMessages, RunHistoryRequest, MaxParallelHistoryRequests);
+
+	// A file failing doesn't discard the histories of the others
+	int32 NumHistoryFailures = 0;
+	for (FFileHistoryRequest& Request : HistoryRequests)
+	{
+		if (!Request.bSuccess)
+		{
+			++NumHistoryFailures;
+		}
+		else if (!Request.FilePath.IsEmpty())
+		{
+			Histories.Add(Request.FilePath, MoveTemp(Request.History));
+		}
+	}
+	Success &= HistoryRequests.IsEmpty() || NumHistoryFailures < HistoryRequests.Num();
+
+	bShouldUpdateConflicts = ConflictsStep.GetResult();
+	bShouldUpdateConflicts &= (ConflictedFilesData.Num() > 0);
+	ConflictsMessages.AppendTo(InCommand);
+	HistoryMessages.AppendTo(InCommand);
 
 	if (bShouldUpdateConflicts) {
-		// Fetch conflict "remote revision" data
-		for (auto& [FilePath, ConflictData] : ConflictedFilesData)
+		// Fetch conflict "remote revision" data - once the files history is in, since it's prepended to it
+		TArray<FFileHistoryRequest> RemoteRevisionRequests;
+		for (const auto& [FilePath, ConflictData] : ConflictedFilesData)
+		{
+			if (ConflictData.RemoteRevision.IsEmpty())
+			{
+				continue;
+			}
+			FFileHistoryRequest& Request = RemoteRevisionRequests.AddDefaulted_GetRef();
+			Request.File = FilePath;
+			Request.MergeFromRef = ConflictData.RemoteRevision;
+		}
+		FStepMessages RemoteRevisionsMessages;
+		RunStepForEach(RemoteRevisionRequests, RemoteRevisionsMessages, RunHistoryRequest, MaxParallelHistoryRequests);
+		RemoteRevisionsMessages.AppendTo(InCommand);
+
+		for (FFileHistoryRequest& Request : RemoteRevisionRequests)
 		{
-			// Get the revision data for the conflicted with file on the other branch
-			DiversionUtils::RunGetHistory(InCommand, InCommand.InfoMessages, InCommand.ErrorMessages,
-				FilePath, &ConflictData.RemoteRevision);
+			if (Request.bSuccess && !Request.FilePath.IsEmpty())
+			{
+				if (const TDiversionHistory* Existing = Histories.Find(Request.FilePath))
+				{
+					Request.History.Append(*Existing);
+				}
+				Histories.Add(Request.FilePath, MoveTemp(Request.History));
+			}
 		}
 	}
 
@@ -10,6 +10,8 @@
 
 #include "SourceControlOperationBase.h"
 #include "FileEntry.h"
+#include "DiversionConfig.h"
+#include "HAL/ThreadSafeBool.h"
 
 #define LOCTEXT_NAMESPACE "SourceControl"
 
@@ -231,6 +233,20 @@ public:
 	{
 		return LOCTEXT("SourceControl_GetPotentialClashes", "Updating file Revision Control status...");
 	}
+
+	/** Stops sending requests, e.g. once a newer refresh supersedes this one. Safe to call from any thread */
+	void Cancel()
+	{
+		bCancelled = true;
+	}
+
+	const FThreadSafeBool& IsCancelled() const
+	{
+		return bCancelled;
+	}
+
+private:
+	FThreadSafeBool bCancelled;
 };
 
 class FGetConflictedFiles : public FSourceControlOperationBase
@@ -326,6 +342,7 @@ public:
 	// IDiversionWorker interface
 	virtual FName GetName() const override;
 	virtual bool Execute(class FDiversionCommand& InCommand) override;
+	virtual EDiversionCommandLane::Type GetLane(const class FDiversionCommand& InCommand) const override { return EDiversionCommandLane::Background; }
 	virtual bool UpdateStates() const override;
 
 public:
@@ -339,6 +356,7 @@ public:
 	// IDiversionWorker interface
 	virtual FName GetName() const override;
 	virtual bool Execute(class FDiversionCommand& InCommand) override;
+	virtual EDiversionCommandLane::Type GetLane(const class FDiversionCommand& InCommand) const override { return EDiversionCommandLane::Background; }
 	virtual bool UpdateStates() const override;
 
 public:
@@ -394,6 +412,7 @@ class FDiversionWsInfoWorker final : public IDiversionWorker, public TSharedFrom
 	// IDiversionWorker interface
 	virtual FName GetName() const override;
 	virtual bool Execute(class FDiversionCommand& InCommand) override;
+	virtual EDiversionCommandLane::Type GetLane(const class FDiversionCommand& InCommand) const override { return EDiversionCommandLane::Background; }
 	virtual bool UpdateStates() const override;
 
 	WorkspaceInfo WsInfo;
@@ -410,6 +429,7 @@ public:
 	// IDiversionWorker interface
 	virtual FName GetName() const override;
 	virtual bool Execute(class FDiversionCommand& InCommand) override;
+	virtual EDiversionCommandLane::Type GetLane(const class FDiversionCommand& InCommand) const override { return EDiversionCommandLane::Background; }
 	virtual bool UpdateStates() const override;
 
 public:
@@ -425,6 +445,7 @@ public:
 	// IDiversionWorker interface
 	virtual FName GetName() const override;
 	virtual bool Execute(class FDiversionCommand& InCommand) override;
+	virtual EDiversionCommandLane::Type GetLane(const class FDiversionCommand& InCommand) const override { return EDiversionCommandLane::Bulk; }
 };
 
 class FDiversionGetPotentialClashes final : public IDiversionWorker
@@ -434,6 +455,7 @@ public:
 	// IDiversionWorker interface
 	virtual FName GetName() const override;
 	virtual bool Execute(class FDiversionCommand& InCommand) override;
+	virtual EDiversionCommandLane::Type GetLane(const class FDiversionCommand& InCommand) const override;
 	virtual bool UpdateStates() const override;
 	
 private:
@@ -443,6 +465,9 @@ private:
 	TMap<FString, TArray<EDiversionPotentialClashInfo>> PotentialClashes;
 	TArray<FString> QueriedPaths;
 	bool bRecursiveRequest = false;
+
+	/** Read from the settings on the game thread, when the worker is created */
+	const int32 MaxParallelRequests = GetDiversionClashRequestParallelism();
 };
 
 class FDiversionGetConflictedFiles final : public IDiversionWorker
@@ -452,6 +477,7 @@ public:
 	// IDiversionWorker interface
 	virtual FName GetName() const override;
 	virtual bool Execute(class FDiversionCommand& InCommand) override;
+	virtual EDiversionCommandLane::Type GetLane(const class FDiversionCommand& InCommand) const override { return EDiversionCommandLane::Background; }
 	virtual bool UpdateStates() const override;
 
 private:
@@ -527,6 +553,9 @@ public:
 private:
 	bool bShouldUpdateStates = false;
 	TMap<FString, TArray<EDiversionPotentialClashInfo>> PotentialClashes;
+
+	/** Read from the settings on the game thread, when the worker is created */
+	const int32 MaxParallelClashRequests = GetDiversionClashRequestParallelism();
 };
 
 // Todo: Diversion doesn't have sync command, this should replace `dv update`
@@ -560,6 +589,7 @@ public:
 	virtual FName GetName() const override;
 	virtual bool Execute(FDiversionCommand& InCommand) override;
 	virtual bool UpdateStates() const override;
+	virtual EDiversionCommandLane::Type GetLane(const FDiversionCommand& InCommand) const override;
 private:
 	bool UpdateHistory(FDiversionCommand& InCommand);
 	bool UpdateConflicts() const;
@@ -581,6 +611,9 @@ private:
 	TArray<Diversion::CoreAPI::Model::Merge> WorkspaceMergesList;
 	TArray<Diversion::CoreAPI::Model::Merge> BranchMergesList;
 	/***/
+
+	/** Read from the settings on the game thread, when the worker is created */
+	const int32 MaxParallelHistoryRequests = GetDiversionHistoryRequestParallelism();
 };
 
 /** Copy or Move operation on a single file */
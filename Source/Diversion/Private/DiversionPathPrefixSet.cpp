@@ -0,0 +1,56 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "DiversionPathPrefixSet.h"
+#include "Misc/Paths.h"
+
+FDiversionPathPrefixSet::FDiversionPathPrefixSet(const TArray<FString>& InPaths)
+{
+	Prefixes.Reserve(InPaths.Num());
+	for (const FString& Path : InPaths)
+	{
+		Add(Path);
+	}
+}
+
+void FDiversionPathPrefixSet::Add(const FString& InPath)
+{
+	FString Prefix = NormalizePath(InPath);
+	MinPrefixLen = FMath::Min(MinPrefixLen, Prefix.Len());
+	MaxPrefixLen = FMath::Max(MaxPrefixLen, Prefix.Len());
+	Prefixes.Add(MoveTemp(Prefix));
+}
+
+bool FDiversionPathPrefixSet::Contains(const FString& InPath) const
+{
+	if (Prefixes.IsEmpty())
+	{
+		return false;
+	}
+
+	FString Ancestor = NormalizePath(InPath);
+	while (Ancestor.Len() >= MinPrefixLen)
+	{
+		if (Ancestor.Len() <= MaxPrefixLen && Prefixes.Contains(Ancestor))
+		{
+			return true;
+		}
+
+		int32 SeparatorIndex = INDEX_NONE;
+		if (!Ancestor.FindLastChar(TEXT('/'), SeparatorIndex))
+		{
+			break;
+		}
+		Ancestor.LeftInline(SeparatorIndex);
+	}
+	return false;
+}
+
+FString FDiversionPathPrefixSet::NormalizePath(const FString& InPath)
+{
+	FString Path = FPaths::ConvertRelativePathToFull(InPath);
+	while (Path.EndsWith(TEXT("/")))
+	{
+		Path.LeftChopInline(1);
+	}
+	return Path;
+}
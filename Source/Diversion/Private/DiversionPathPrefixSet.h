@@ -0,0 +1,60 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Set of directory (or file) paths answering whether a path is one of them or under one of them,
+ * with the semantics of FPaths::IsUnderDirectory against each of the paths - including its case
+ * sensitivity, paths only match regardless of case on Windows.
+ * A lookup walks up the ancestors of the queried path with a hash lookup each, so it costs
+ * O(path depth) regardless of the number of paths in the set.
+ */
+class FDiversionPathPrefixSet
+{
+public:
+	FDiversionPathPrefixSet() = default;
+	explicit FDiversionPathPrefixSet(const TArray<FString>& InPaths);
+
+	void Add(const FString& InPath);
+
+	/** True if InPath equals or is under any of the paths of the set */
+	bool Contains(const FString& InPath) const;
+
+	int32 Num() const { return Prefixes.Num(); }
+
+private:
+	/** Full path, forward slashes and no trailing slash */
+	static FString NormalizePath(const FString& InPath);
+
+private:
+#if PLATFORM_WINDOWS
+	static constexpr ESearchCase::Type PathSearchCase = ESearchCase::IgnoreCase;
+#else
+	static constexpr ESearchCase::Type PathSearchCase = ESearchCase::CaseSensitive;
+#endif
+
+	/** Compares the paths like FPaths::IsUnderDirectory does on the platform, TSet<FString> alone ignores case everywhere */
+	struct FPathKeyFuncs : DefaultKeyFuncs<FString>
+	{
+		static bool Matches(const FString& A, const FString& B)
+		{
+			return A.Equals(B, PathSearchCase);
+		}
+
+		static uint32 GetKeyHash(const FString& Key)
+		{
+#if PLATFORM_WINDOWS
+			return GetTypeHash(Key);
+#else
+			return FCrc::StrCrc32(*Key);
+#endif
+		}
+	};
+
+	TSet<FString, FPathKeyFuncs> Prefixes;
+	/** Length range of the paths in the set - ancestors out of it can't match and aren't looked up */
+	int32 MinPrefixLen = MAX_int32;
+	int32 MaxPrefixLen = 0;
+};
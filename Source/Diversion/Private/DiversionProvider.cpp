@@ -3,7 +3,6 @@
 #include "DiversionProvider.h"
 #include "DiversionState.h"
 #include "Misc/Paths.h"
-#include "Misc/QueuedThreadPool.h"
 #include "DiversionCommand.h"
 #include "DiversionConfig.h"
 #include "ISourceControlModule.h"
@@ -17,18 +16,55 @@
 #include "Interfaces/IPluginManager.h"
 #include "DiversionOperations.h"
 #include "DiversionConstants.h"
+#include "DiversionStateCacheFile.h"
+#include "DefaultApi.h"
 #include "CustomWidgets/DiversionPotentialClashUI.h"
 #include "ContentBrowserModule.h"
 #include "PackageTools.h"
 #include "DirectoryWatcherModule.h"
 #include "Modules/ModuleManager.h"
 #include "UObject/ObjectSaveContext.h"
+#include "HAL/IConsoleManager.h"
+#include "Algo/AllOf.h"
 
 
 #define LOCTEXT_NAMESPACE "Diversion"
 
 static FName ProviderName("Diversion");
 
+static FAutoConsoleCommand StateCacheStatsCommand(
+	TEXT("Diversion.StateCacheStats"),
+	TEXT("Logs the size, hit rate and eviction counters of the Diversion state cache"),
+	FConsoleCommandDelegate::CreateLambda([]() {
+		if (!FDiversionModule::IsLoaded())
+		{
+			return;
+		}
+		const FDiversionStateCacheStats Stats = FDiversionModule::Get().GetProvider().GetStateCacheStats();
+		UE_LOG(LogSourceControl, Display, TEXT("Diversion state cache: %d states (cap %d), hit rate %.2f (%llu hits, %llu misses), %llu evictions in %llu passes"),
+			Stats.Num, GetDiversionMaxCachedStates(), Stats.GetHitRate(), Stats.Hits, Stats.Misses, Stats.Evictions, Stats.EvictionPasses);
+	}));
+
+static FAutoConsoleCommand CommandLaneStatsCommand(
+	TEXT("Diversion.CommandLaneStats"),
+	TEXT("Logs the queue depth, wait and execution times of the Diversion command lanes"),
+	FConsoleCommandDelegate::CreateLambda([]() {
+		if (!FDiversionModule::IsLoaded())
+		{
+			return;
+		}
+		const FDiversionProvider& Provider = FDiversionModule::Get().GetProvider();
+		for (int32 LaneIndex = 0; LaneIndex < EDiversionCommandLane::Num; ++LaneIndex)
+		{
+			const EDiversionCommandLane::Type Lane = static_cast<EDiversionCommandLane::Type>(LaneIndex);
+			const FDiversionCommandLaneStats Stats = Provider.GetCommandLaneStats(Lane);
+			UE_LOG(LogSourceControl, Display, TEXT("Diversion %s lane: %d queued, %d running, %llu completed, wait %.3fs avg %.3fs max, execution %.3fs avg %.3fs max"),
+				EDiversionCommandLane::ToString(Lane), Stats.QueueDepth, Stats.InFlight, Stats.Completed,
+				Stats.GetAverageWaitSeconds(), Stats.MaxWaitSeconds, Stats.GetAverageExecutionSeconds(), Stats.MaxExecutionSeconds);
+		}
+		UE_LOG(LogSourceControl, Display, TEXT("Diversion commands waiting for room in the lane queues: %d"), Provider.GetNumOverflowCommands());
+	}));
+
 
 void OverrideLocalizationStrings()
 {
@@ -286,13 +322,13 @@ void FDiversionProvider::Init(bool bForceConnection)
 				return;
 			}
 
-			const auto Operation = ISourceControlOperation::Create<FUpdateStatus>();
-			Execute(Operation, nullptr, { WsInfo.Get().GetPath() }, EConcurrency::Asynchronous);
+			IssueBackgroundStatus();
 		});
 		
 		BackgroundStatus = MakeUnique<FTimedDelegateWrapper>(
 			BackgroundStatusDelegate, SECONDS_TO_POLL_STATUS);
 		BackgroundStatus->Start();
+		StartWatchingProjectDirectories();
 
 		auto BackgroundPotentialClashesDelegate = DiversionTimerDelegate::CreateLambda([this]() {
 			if (!bDiversionAvailable) {
@@ -305,7 +341,13 @@ void FDiversionProvider::Init(bool bForceConnection)
 				return;
 			}
 
+			// Whatever the previous refresh didn't request yet would be outdated by this one
+			if (const TSharedPtr<FGetPotentialClashes, ESPMode::ThreadSafe> PreviousRefresh = FullPotentialClashesRefresh.Pin())
+			{
+				PreviousRefresh->Cancel();
+			}
 			auto operation = ISourceControlOperation::Create<FGetPotentialClashes>();
+			FullPotentialClashesRefresh = operation;
 			Execute(operation, nullptr, { WsInfo.Get().GetPath() }, EConcurrency::Asynchronous);
 		});
 
@@ -334,6 +376,9 @@ void FDiversionProvider::Init(bool bForceConnection)
 		BackgroundConflictedFiles->Start();
 		BackgroundConflictedFiles->TriggerInstantCallAndReset();
 
+		// Show the states of the previous session until the background status revalidates them
+		LoadPersistedStates();
+
 		// Add the Diversion potential clash indicator to the asset view
 		SPotentialClashIndicator::CacheIndicatorBrush();
 		if (FContentBrowserModule* ContentBrowserModule = FModuleManager::Get().GetModulePtr<FContentBrowserModule>(TEXT("ContentBrowser")))
@@ -390,26 +435,49 @@ bool FDiversionProvider::CheckDiversionAvailability()
 
 void FDiversionProvider::Close()
 {
+	// Only persist states of a session that was actually up, Close() might be called more than once
+	if (bDiversionAvailable)
+	{
+		SavePersistedStates();
+		FDiversionModule::Get().GetHistoryCache().Save();
+	}
+
+	StopWatchingProjectDirectories();
 
 	// clear the cache
 	StateCache.Empty();
+	WorkingCopyStateIndex.Empty();
+	ConfigFileStates.Empty();
 
 	bDiversionAvailable = false;
 	UserEmail.Empty();
 	bDiversionStopped = true;
 
-	// Wait for all commands to finish but exit if it takes too long
+	// The events thread winds down on its own once its last long poll returns, nothing waits for it
+	if (AgentEvents.IsValid())
+	{
+		AgentEvents->RequestStop();
+		AgentEvents.Reset();
+	}
+
+	AbandonQueuedCommands();
+
+	// Wait for the running commands to finish but exit if it takes too long
 	// This is to avoid a deadlock when the engine is shutting down	
 
 	auto WaitForCommandsDelegate = WaitForConditionPredicate::CreateLambda([this]() { 
 		Tick();
-		return CommandQueue.Num() == 0; 
+		return NumPendingCommands == 0; 
 	});
 	bool Success = DiversionUtils::WaitForCondition(WaitForCommandsDelegate, 30.0);
 	if(!Success)
 	{
 		UE_LOG(LogSourceControl, Error, TEXT("Failed to fully close Diversion provider, there are still pending commands"));
 	}
+	// Joins the command threads
+	CommandScheduler.Reset();
+	// Return the results of the abandoned commands
+	FinalizeCompletedCommands(TNumericLimits<double>::Max());
 	UPackage::PackageSavedEvent.RemoveAll(this);
 
 	// Reset localization strings
@@ -426,6 +494,27 @@ void FDiversionProvider::Close()
 	PotentialClashUIIconDelegateHandle.Reset();
 }
 
+void FDiversionProvider::AbandonQueuedCommands()
+{
+	for (const TPair<FDiversionCommand*, EDiversionCommandLane::Type>& Overflow : OverflowCommands)
+	{
+		Overflow.Key->Abandon();
+	}
+	OverflowCommands.Empty();
+	if (CommandScheduler.IsValid())
+	{
+		CommandScheduler->AbandonQueued();
+	}
+	// This frame's status requests too, the scheduler abandons them right away
+	IssuePendingStatusCommands();
+
+	// The repo wide clashes refresh runs many requests, stop it between two of them
+	if (const TSharedPtr<FGetPotentialClashes, ESPMode::ThreadSafe> ClashesRefresh = FullPotentialClashesRefresh.Pin())
+	{
+		ClashesRefresh->Cancel();
+	}
+}
+
 FText FDiversionProvider::GetStatusText() const
 {
 	FString AgentStatus = IsAgentAlive() ? "alive" : "not running";
@@ -465,23 +554,23 @@ bool FDiversionProvider::IsEnabled() const
 
 /** Diversion version for feature checking */
 
-const FDiversionVersion& FDiversionProvider::GetDiversionVersion(EConcurrency::Type Concurrency, bool InForceUpdate)
+FDiversionVersion FDiversionProvider::GetDiversionVersion(EConcurrency::Type Concurrency, bool InForceUpdate)
 {
 	if (!DiversionUtils::DiversionValidityCheck(IsInGameThread(), 
 			"GetDiversionVersion called outside of main thread", FDiversionModule::Get().GetOriginalAccountID())) {
-		return DvVersion.Get();
+		return GetDiversionVersion();
 	}
 
-	return DvVersion.GetUpdate(DvVersion.Get(),
+	return DvVersion.GetUpdate(FDiversionVersion(""),
 		FOnCacheUpdate::CreateLambda([this, &Concurrency]() {
 			auto operation = ISourceControlOperation::Create<FAgentHealthCheck>();
 			Execute(operation, nullptr, TArray<FString>(), Concurrency);
 			}), InForceUpdate);
 }
 
-const FDiversionVersion& FDiversionProvider::GetDiversionVersion() const 
+FDiversionVersion FDiversionProvider::GetDiversionVersion() const 
 {
-	return DvVersion.Get();
+	return DvVersion.GetUnexpired(FDiversionVersion(""));
 }
 
 WorkspaceInfo FDiversionProvider::GetWsInfo(EConcurrency::Type Concurrency, bool InForceUpdate)
@@ -510,6 +599,12 @@ void FDiversionProvider::SetDvVersion(const FDiversionVersion& InVersion)
 	}
 
 	DvVersion.Set(InVersion);
+	if (GetSnapshot()->IsAgentAlive != InVersion.IsValid())
+	{
+		PublishSnapshot([&InVersion](FDiversionProviderSnapshot& NewSnapshot) {
+			NewSnapshot.IsAgentAlive = InVersion.IsValid();
+		});
+	}
 }
 
 void FDiversionProvider::SetWorkspaceInfo(const WorkspaceInfo& InWsInfo)
@@ -521,6 +616,9 @@ void FDiversionProvider::SetWorkspaceInfo(const WorkspaceInfo& InWsInfo)
 
 	bDiversionAvailable = WsInfo.Get().IsValid();
 	WsInfo.Set(InWsInfo);
+	PublishSnapshot([&InWsInfo](FDiversionProviderSnapshot& NewSnapshot) {
+		NewSnapshot.WsInfo = InWsInfo;
+	});
 }
 
 void FDiversionProvider::SetSyncStatus(const DiversionUtils::EDiversionWsSyncStatus& InSyncStatus)
@@ -531,6 +629,52 @@ void FDiversionProvider::SetSyncStatus(const DiversionUtils::EDiversionWsSyncSta
 	}
 
 	SyncStatus.Set(InSyncStatus);
+	if (GetSnapshot()->SyncStatus != InSyncStatus)
+	{
+		PublishSnapshot([&InSyncStatus](FDiversionProviderSnapshot& NewSnapshot) {
+			NewSnapshot.SyncStatus = InSyncStatus;
+		});
+	}
+}
+
+FDiversionProviderSnapshotRef FDiversionProvider::GetSnapshot() const
+{
+	FReadScopeLock Lock(SnapshotLock);
+	return Snapshot;
+}
+
+FDiversionProviderSnapshotRef FDiversionProvider::GetRevalidatedSnapshot()
+{
+	const bool bAgentAlive = IsAgentAlive();
+	if (GetSnapshot()->IsAgentAlive != bAgentAlive)
+	{
+		PublishSnapshot([bAgentAlive](FDiversionProviderSnapshot& NewSnapshot) {
+			NewSnapshot.IsAgentAlive = bAgentAlive;
+		});
+	}
+	return GetSnapshot();
+}
+
+void FDiversionProvider::SetStatusFingerprint(uint32 InFingerprint)
+{
+	if (GetSnapshot()->StatusFingerprint != InFingerprint)
+	{
+		PublishSnapshot([InFingerprint](FDiversionProviderSnapshot& NewSnapshot) {
+			NewSnapshot.StatusFingerprint = InFingerprint;
+		});
+	}
+}
+
+void FDiversionProvider::PublishSnapshot(TFunctionRef<void(FDiversionProviderSnapshot&)> InUpdate)
+{
+	check(IsInGameThread());
+
+	// Readers only ever see complete snapshots, the lock only guards swapping the reference
+	TSharedRef<FDiversionProviderSnapshot, ESPMode::ThreadSafe> NewSnapshot = MakeShared<FDiversionProviderSnapshot, ESPMode::ThreadSafe>(*GetSnapshot());
+	InUpdate(*NewSnapshot);
+
+	FWriteScopeLock Lock(SnapshotLock);
+	Snapshot = NewSnapshot;
 }
 
 DiversionUtils::EDiversionWsSyncStatus FDiversionProvider::GetSyncStatus() const
@@ -628,12 +772,19 @@ void FDiversionProvider::UpdateModifiedStates(const TMap<FString, TSharedRef<FDi
 {
 	for (auto& State : ModifiedStates) {
 		if (!InNewModifiedStates.Contains(State.Key)) {
+			SetCachedWorkingCopyState(State.Value, EWorkingCopyState::Unchanged);
 			State.Value->ResetState();
 		}
 	}
 	// Reset the list of modified states only if we requested a full repo status update
+	const bool bModifiedFilesChanged = InNewModifiedStates.Num() != ModifiedStates.Num() ||
+		!Algo::AllOf(InNewModifiedStates, [this](const auto& Pair) { return ModifiedStates.Contains(Pair.Key); });
 	ModifiedStates = InNewModifiedStates;
-	AddCurrentChangesToChangelistState();
+	// The changelist only lists the files, their states are shared with the cache
+	if (bModifiedFilesChanged)
+	{
+		AddCurrentChangesToChangelistState();
+	}
 }
 
 bool FDiversionProvider::IsPackageExpired(const FSyncInaccessiblePackages& SyncInaccessiblePackage) const
@@ -643,20 +794,29 @@ bool FDiversionProvider::IsPackageExpired(const FSyncInaccessiblePackages& SyncI
 
 bool FDiversionProvider::UpdateCachedStates(const TMap<FString, FDiversionState>& InNewStates, const bool IsFullStatusUpdate)
 {
-	int NbStatesUpdated = 0;
+	// Whether anything differs from what was cached, drives the background status polling interval and the broadcast
+	bool bStatesChanged = false;
 	TMap<FString, TSharedRef<FDiversionState>> NewModifiedStates;
+	// The caller records the fingerprint of the status the cache matches once it's applied
+	SetStatusFingerprint(0);
 	
 	// Update the local cached states
 	for (const auto& [_, NewStateValue] : InNewStates)
 	{
 		const TSharedRef<FDiversionState> CachedState = GetStateInternal(NewStateValue.LocalFilename);
-		CachedState->WorkingCopyState = NewStateValue.WorkingCopyState;
+		bStatesChanged |= CachedState->WorkingCopyState != NewStateValue.WorkingCopyState;
+		SetCachedWorkingCopyState(CachedState, NewStateValue.WorkingCopyState);
 		CachedState->TimeStamp = NewStateValue.TimeStamp;
-		if(NewStateValue.Hash != TEXT(""))
+		if(NewStateValue.HasHash())
 		{
-			CachedState->Hash = NewStateValue.Hash;
+			const FString NewHash = NewStateValue.GetHash();
+			if(!CachedState->HasHash() || CachedState->GetHash() != NewHash)
+			{
+				bStatesChanged = true;
+				MarkStatesChanged();
+			}
+			CachedState->SetHash(NewHash);
 		}
-		NbStatesUpdated++;
 
 		// State handling parts:
 		// Used for modified states cache management
@@ -676,6 +836,13 @@ bool FDiversionProvider::UpdateCachedStates(const TMap<FString, FDiversionState>
 	// TODO: Fix the bug in UE level - part of AssetRegistry module
 	if(IsFullStatusUpdate)
 	{
+		// Files no longer modified don't show up in the status at all
+		bStatesChanged |= NewModifiedStates.Num() != ModifiedStates.Num() ||
+			!Algo::AllOf(NewModifiedStates, [this](const auto& Pair) { return ModifiedStates.Contains(Pair.Key); });
+		if (BackgroundStatus.IsValid())
+		{
+			BackgroundStatus->ReportPollResult(bStatesChanged);
+		}
 		UpdateModifiedStates(NewModifiedStates);
 		// Reset the caching interval timer to maintain the inetrval between calls to the BE 
 		// Note - This doesn't affect calls generated by UE!
@@ -686,24 +853,41 @@ bool FDiversionProvider::UpdateCachedStates(const TMap<FString, FDiversionState>
 	{
 		for (auto& State : SynchingStates)
 		{
+			if (State.Value->IsSyncing)
+			{
+				bStatesChanged = true;
+				MarkStatesChanged();
+			}
 			State.Value->IsSyncing = false;
 		}
 	}
 
 	BackgroundStatusSkipToNextInterval();
-	return (NbStatesUpdated > 0);
+	return bStatesChanged;
 }
 
 bool FDiversionProvider::UpdateConflictedStates(const TMap<FString, FDiversionResolveInfo>& ConflictedFilesData)
 {
 	int NbStatesUpdated = 0;
 
+	const bool bConflictsChanged = ConflictedFilesData.Num() != ConflictedStates.Num() ||
+		!Algo::AllOf(ConflictedFilesData, [this](const auto& Pair) { return ConflictedStates.Contains(Pair.Key); });
+	if (BackgroundConflictedFiles.IsValid())
+	{
+		BackgroundConflictedFiles->ReportPollResult(bConflictsChanged);
+	}
+
 	// Reset the states data
-	for(auto& [_, State] : ConflictedStates)
+	for(auto& [FilePath, State] : ConflictedStates)
 	{
 		State->ClearResolveInfo();
+		if(!ConflictedFilesData.Contains(FilePath))
+		{
+			MarkStatesChanged();
+		}
 	}
-	ConflictedStates.Empty();
+	TMap<FString, TSharedRef<FDiversionState>> PreviousConflictedStates = MoveTemp(ConflictedStates);
+	ConflictedStates.Reset();
 	
 	// Update the conflicted states
 	for(auto& [FilePath, ResolveInfo] : ConflictedFilesData)
@@ -711,9 +895,23 @@ bool FDiversionProvider::UpdateConflictedStates(const TMap<FString, FDiversionRe
 		const TSharedRef<FDiversionState> CachedState = GetStateInternal(FilePath);
 		CachedState->AddPendingResolveInfo(ResolveInfo);
 		ConflictedStates.Add(FilePath, CachedState);
+		if(!PreviousConflictedStates.Contains(FilePath))
+		{
+			MarkStatesChanged();
+		}
 		NbStatesUpdated++;
 	}
 
+	// Most polls find the same conflicts, the commands keep sharing the published set then
+	if (bConflictsChanged)
+	{
+		PublishSnapshot([this](FDiversionProviderSnapshot& NewSnapshot) {
+			TSet<FString> ConflictedFiles;
+			ConflictedStates.GetKeys(ConflictedFiles);
+			NewSnapshot.ConflictedFiles = MakeShared<const TSet<FString>, ESPMode::ThreadSafe>(MoveTemp(ConflictedFiles));
+		});
+	}
+
 	return (NbStatesUpdated > 0);
 }
 
@@ -725,7 +923,15 @@ bool FDiversionProvider::RemoveConflictedState(const FString& Path)
 		return false;
 	}
 	ConflictedState->Get().ClearResolveInfo();
-	return ConflictedStates.Remove(Path) > 0;
+	ConflictedStates.Remove(Path);
+	MarkStatesChanged();
+
+	PublishSnapshot([&Path](FDiversionProviderSnapshot& NewSnapshot) {
+		TSet<FString> ConflictedFiles = *NewSnapshot.ConflictedFiles;
+		ConflictedFiles.Remove(Path);
+		NewSnapshot.ConflictedFiles = MakeShared<const TSet<FString>, ESPMode::ThreadSafe>(MoveTemp(ConflictedFiles));
+	});
+	return true;
 }
 
 TUniquePtr<FDiversionResolveInfo> FDiversionProvider::GetFileResolveInfo(const FString& Path) const
@@ -737,11 +943,6 @@ TUniquePtr<FDiversionResolveInfo> FDiversionProvider::GetFileResolveInfo(const F
 	return nullptr;
 }
 
-void FDiversionProvider::GetConflictedFilesPaths(TArray<FString>& OutArray) const
-{
-	return ConflictedStates.GenerateKeyArray(OutArray);
-}
-
 void FDiversionProvider::SetFilesToResolve(const TMap<FString, FDiversionResolveInfo>& InFilesToResolve)
 {
     FilesToResolve = InFilesToResolve;
@@ -765,7 +966,12 @@ bool FDiversionProvider::UpdatePotentialClashedStates(
 		{
 			if(!InPotentialClashes.Contains(FileName))
 			{
-				State->PotentialClashes.ResetPotentialClashes();
+				if(State->GetPotentialClashesCount() > 0)
+				{
+					State->BumpPotentialClashesVersion();
+					MarkStatesChanged();
+				}
+				State->ResetPotentialClashes();
 				KeysToRemove.Add(FileName);
 			}
 			NbStatesUpdated++;
@@ -783,23 +989,60 @@ bool FDiversionProvider::UpdatePotentialClashedStates(
 	{
 		if(const auto* CachedState = PotentiallyClashedStates.Find(Filename); CachedState != nullptr)
 		{
-			(*CachedState)->PotentialClashes.SetPotentialClashes(PotentialClashInfo);
+			if((*CachedState)->GetPotentialClashes() != PotentialClashInfo)
+			{
+				(*CachedState)->BumpPotentialClashesVersion();
+				MarkStatesChanged();
+			}
+			(*CachedState)->SetPotentialClashes(PotentialClashInfo);
 		}
 		else
 		{
 			TSharedRef<FDiversionState> NewCachedState = GetStateInternal(Filename);
-			NewCachedState->PotentialClashes.SetPotentialClashes(PotentialClashInfo);
+			if(NewCachedState->GetPotentialClashes() != PotentialClashInfo)
+			{
+				NewCachedState->BumpPotentialClashesVersion();
+				MarkStatesChanged();
+			}
+			NewCachedState->SetPotentialClashes(PotentialClashInfo);
 			PotentiallyClashedStates.Add(Filename, NewCachedState);
 		}
 		NbStatesUpdated++;
 	}
-	
+
 	return (NbStatesUpdated > 0);
 }
 
-void FDiversionProvider::GetCurrentPotentialClashes(TArray<FString>& OutPotentialClashedPaths) const
+void FDiversionProvider::SetCachedWorkingCopyState(const TSharedRef<FDiversionState>& InState, EWorkingCopyState::Type InWorkingCopyState)
 {
-	PotentiallyClashedStates.GetKeys(OutPotentialClashedPaths);
+	const EWorkingCopyState::Type PreviousWorkingCopyState = InState->WorkingCopyState;
+	if(PreviousWorkingCopyState == InWorkingCopyState)
+	{
+		return;
+	}
+
+	if(auto* PreviousBucket = WorkingCopyStateIndex.Find(PreviousWorkingCopyState))
+	{
+		PreviousBucket->Remove(InState->LocalFilename);
+	}
+	InState->WorkingCopyState = InWorkingCopyState;
+	if(!IsCleanWorkingCopyState(InWorkingCopyState))
+	{
+		WorkingCopyStateIndex.FindOrAdd(InWorkingCopyState).Add(InState);
+	}
+	MarkStatesChanged();
+}
+
+void FDiversionProvider::RemoveFromStateIndexes(const FString& Filename)
+{
+	if(const auto* State = StateCache.Find(Filename))
+	{
+		if(auto* Bucket = WorkingCopyStateIndex.Find((*State)->WorkingCopyState))
+		{
+			Bucket->Remove(Filename);
+		}
+	}
+	ConfigFileStates.Remove(Filename);
 }
 
 TSharedRef<FDiversionState, ESPMode::ThreadSafe> FDiversionProvider::GetStateInternal(const FString& Filename)
@@ -808,20 +1051,152 @@ TSharedRef<FDiversionState, ESPMode::ThreadSafe> FDiversionProvider::GetStateInt
 	if (State != NULL)
 	{
 		// found cached item
+		StateCacheStats.Hits++;
+		(*State)->LastAccessTime = FPlatformTime::Seconds();
 		return (*State);
 	}
 	else
 	{
 		// cache an unknown state for this item
+		StateCacheStats.Misses++;
 		TSharedRef<FDiversionState, ESPMode::ThreadSafe> NewState = MakeShareable(new FDiversionState(Filename));
-		StateCache.Add(Filename, NewState);
+		NewState->LastAccessTime = FPlatformTime::Seconds();
+		// New states are Unknown, they only get indexed once their working copy state is set
+		StateCache.Add(NewState);
+		if(IsConfigFile(Filename))
+		{
+			ConfigFileStates.Add(Filename);
+		}
 		return NewState;
 	}
 }
 
+void FDiversionProvider::SavePersistedStates() const
+{
+	FDiversionPersistedStates PersistedStates;
+	for (const TSharedRef<FDiversionState>& State : StateCache)
+	{
+		// Unknown states carry no information worth restoring
+		if (State->WorkingCopyState != EWorkingCopyState::Unknown)
+		{
+			PersistedStates.States.Add(State->LocalFilename, *State);
+		}
+	}
+	for (const auto& [FilePath, State] : ConflictedStates)
+	{
+		PersistedStates.ConflictedFiles.Add(FilePath, State->GetPendingResolveInfo());
+	}
+	for (const auto& [FilePath, State] : PotentiallyClashedStates)
+	{
+		if (State->GetPotentialClashesCount() > 0)
+		{
+			PersistedStates.PotentialClashes.Add(FilePath, State->GetPotentialClashes());
+		}
+	}
+
+	DiversionStateCacheFile::Save(WsInfo.Get(), PersistedStates);
+}
+
+void FDiversionProvider::LoadPersistedStates()
+{
+	FDiversionPersistedStates PersistedStates;
+	if (!DiversionStateCacheFile::Load(WsInfo.Get(), PersistedStates))
+	{
+		return;
+	}
+
+	UpdateCachedStates(PersistedStates.States, true);
+	UpdateConflictedStates(PersistedStates.ConflictedFiles);
+	UpdatePotentialClashedStates(PersistedStates.PotentialClashes, true);
+	BroadcastStateChanges();
+
+	// Revalidate the restored states right away instead of waiting for the next interval
+	BackgroundStatusTriggerInstantCall();
+}
+
+FDiversionStateCacheStats FDiversionProvider::GetStateCacheStats() const
+{
+	FDiversionStateCacheStats Stats = StateCacheStats;
+	Stats.Num = StateCache.Num();
+	return Stats;
+}
+
+bool FDiversionProvider::IsEvictableState(const TSharedRef<FDiversionState>& InState, double EvictBeforeTime)
+{
+	// Clean states are only referenced by StateCache itself, they are left out of WorkingCopyStateIndex.
+	// Anything above that is either another tracking map (modified, clashed, syncing, conflicted...)
+	// or a state that was handed out and is still in use.
+	constexpr int32 CacheOwnedReferences = 1;
+
+	return IsCleanWorkingCopyState(InState->WorkingCopyState)
+		&& InState->LastAccessTime < EvictBeforeTime
+		&& !InState->IsSyncing
+		&& InState.GetSharedReferenceCount() <= CacheOwnedReferences
+		&& InState->GetPotentialClashesCount() == 0
+		&& !InState->IsConflicted();
+}
+
+void FDiversionProvider::EvictStatesIfNeeded()
+{
+	const int32 MaxCachedStates = GetDiversionMaxCachedStates();
+	if (MaxCachedStates <= 0 || StateCache.Num() <= MaxCachedStates)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastStateCacheEvictionTime < SECONDS_BETWEEN_STATE_CACHE_EVICTIONS)
+	{
+		return;
+	}
+	LastStateCacheEvictionTime = Now;
+	StateCacheStats.EvictionPasses++;
+
+	const double EvictBeforeTime = Now - SECONDS_STATE_CACHE_MIN_IDLE;
+	const int32 TargetNum = FMath::FloorToInt32(MaxCachedStates * STATE_CACHE_EVICTION_LOW_WATERMARK);
+	const int32 NumToEvict = StateCache.Num() - TargetNum;
+	const int32 MaxIndex = StateCache.GetMaxIndex();
+	const int32 NumToScan = FMath::Min(MaxIndex, STATE_CACHE_EVICTION_SCAN_LIMIT);
+	int32 NumEvicted = 0;
+	for (int32 NumScanned = 0; NumScanned < NumToScan && NumEvicted < NumToEvict; ++NumScanned)
+	{
+		if (StateCacheEvictionHand >= MaxIndex)
+		{
+			StateCacheEvictionHand = 0;
+		}
+		// Removing an element leaves its slot empty, the other elements keep their index
+		const FSetElementId ElementId = FSetElementId::FromInteger(StateCacheEvictionHand++);
+		if (!StateCache.IsValidId(ElementId))
+		{
+			continue;
+		}
+		// Not copied, the cache must hold the only reference of an evictable state
+		const TSharedRef<FDiversionState>& State = StateCache[ElementId];
+		if (IsEvictableState(State, EvictBeforeTime))
+		{
+			// Clean states are in no other index
+			ConfigFileStates.Remove(State->LocalFilename);
+			StateCache.Remove(ElementId);
+			++NumEvicted;
+		}
+	}
+	StateCacheStats.Evictions += NumEvicted;
+
+	if (NumEvicted == 0)
+	{
+		UE_LOG(LogSourceControl, Verbose, TEXT("State cache is over its cap (%d/%d) but no state can be evicted"), StateCache.Num(), MaxCachedStates);
+		return;
+	}
+
+	const FDiversionStateCacheStats Stats = GetStateCacheStats();
+	UE_LOG(LogSourceControl, Verbose, TEXT("Evicted %d states from the state cache. Size: %d, hit rate: %.2f, total evictions: %llu"),
+		NumEvicted, Stats.Num, Stats.GetHitRate(), Stats.Evictions);
+}
+
 void FDiversionProvider::AddSyncingState(const FString& Path, const TSharedRef<class FDiversionState>& InState)
 {
 	SynchingStates.Add(Path, InState);
+	MarkStatesChanged();
 }
 
 ECommandResult::Type FDiversionProvider::GetState(const TArray<FSourceControlChangelistRef>& InChangelists, TArray<FSourceControlChangelistStateRef>& OutState, EStateCacheUsage::Type InStateCacheUsage)
@@ -835,7 +1210,7 @@ ECommandResult::Type FDiversionProvider::GetState(const TArray<FSourceControlCha
 	return ECommandResult::Succeeded;
 }
 
-bool IsConfigFile(const FString& FilePath)
+bool FDiversionProvider::IsConfigFile(const FString& FilePath)
 {
 	// Check if the file has an .ini extension
 	if (!FilePath.EndsWith(TEXT(".ini")))
@@ -843,27 +1218,23 @@ bool IsConfigFile(const FString& FilePath)
 		return false;
 	}
 
-	// Get the path to the project's Config directory
-	FString ConfigDir = FPaths::ConvertRelativePathToFull(FPaths::ProjectConfigDir());
-
-	// Check if FilePath starts with the project's Config directory path
-	if (FilePath.StartsWith(ConfigDir))
+	// Get the path to the project's Config directory - it doesn't change during the session
+	if (ProjectConfigDir.IsEmpty())
 	{
-		return true;
+		ProjectConfigDir = FPaths::ConvertRelativePathToFull(FPaths::ProjectConfigDir());
 	}
 
-	return false;
+	// Check if FilePath starts with the project's Config directory path
+	return FilePath.StartsWith(ProjectConfigDir);
 }
 
 TArray<FSourceControlStateRef> FDiversionProvider::GetCachedStateByPredicate(TFunctionRef<bool(const FSourceControlStateRef&)> Predicate) const
 {
 	TArray<FSourceControlStateRef> Result;
-	for (const auto& CacheItem : StateCache)
+	for (const TSharedRef<FDiversionState>& State : StateCache)
 	{
-		FSourceControlStateRef State = CacheItem.Value;
-		
 		// Ignore configuration files states, since they are added already by the SCC
-		if (Predicate(State) && !IsConfigFile(State->GetFilename()))
+		if (!ConfigFileStates.Contains(State->LocalFilename) && Predicate(State))
 		{
 			Result.Add(State);
 		}
@@ -871,8 +1242,39 @@ TArray<FSourceControlStateRef> FDiversionProvider::GetCachedStateByPredicate(TFu
 	return Result;
 }
 
+TArray<FSourceControlStateRef> FDiversionProvider::GetChangedStatesByPredicate(TFunctionRef<bool(const FSourceControlStateRef&)> Predicate) const
+{
+	TArray<FSourceControlStateRef> Result;
+	TSet<const FDiversionState*> VisitedStates;
+	auto VisitState = [this, &Predicate, &Result, &VisitedStates](const TSharedRef<FDiversionState>& InState)
+	{
+		bool bAlreadyVisited = false;
+		VisitedStates.Add(&InState.Get(), &bAlreadyVisited);
+		if (!bAlreadyVisited && !ConfigFileStates.Contains(InState->LocalFilename) && Predicate(InState))
+		{
+			Result.Add(InState);
+		}
+	};
+	for (const auto& [_, Bucket] : WorkingCopyStateIndex)
+	{
+		for (const TSharedRef<FDiversionState>& State : Bucket)
+		{
+			VisitState(State);
+		}
+	}
+	for (const TMap<FString, TSharedRef<FDiversionState>>* TrackedStates : { &ConflictedStates, &PotentiallyClashedStates, &SynchingStates })
+	{
+		for (const auto& [_, State] : *TrackedStates)
+		{
+			VisitState(State);
+		}
+	}
+	return Result;
+}
+
 bool FDiversionProvider::RemoveFileFromCache(const FString& Filename)
 {
+	RemoveFromStateIndexes(Filename);
 	return StateCache.Remove(Filename) > 0;
 }
 
@@ -938,10 +1340,90 @@ ECommandResult::Type FDiversionProvider::Execute(const FSourceControlOperationRe
 	else
 	{
 		Command->bAutoDelete = true;
+		if (IsCoalescableStatusCommand(*Command))
+		{
+			return CoalesceStatusCommand(Command);
+		}
 		return IssueCommand(*Command);
 	}
 }
 
+bool FDiversionProvider::IsCoalescableStatusCommand(const FDiversionCommand& InCommand)
+{
+	if (InCommand.GetConcurrency() != EConcurrency::Asynchronous || InCommand.Files.Num() == 0 ||
+		InCommand.Operation->GetName() != "UpdateStatus")
+	{
+		return false;
+	}
+	// History requests do much more than a status query, they run on their own
+	return !StaticCastSharedRef<FUpdateStatus>(InCommand.Operation)->ShouldUpdateHistory();
+}
+
+bool FDiversionProvider::HaveSameStatusFlags(const FDiversionCommand& InCommand, const FDiversionCommand& InOtherCommand)
+{
+	const FUpdateStatus& Operation = StaticCastSharedRef<FUpdateStatus>(InCommand.Operation).Get();
+	const FUpdateStatus& OtherOperation = StaticCastSharedRef<FUpdateStatus>(InOtherCommand.Operation).Get();
+	return Operation.ShouldUpdateHistory() == OtherOperation.ShouldUpdateHistory()
+		&& Operation.ShouldGetOpenedOnly() == OtherOperation.ShouldGetOpenedOnly()
+		&& Operation.ShouldUpdateModifiedState() == OtherOperation.ShouldUpdateModifiedState()
+		&& Operation.ShouldCheckAllFiles() == OtherOperation.ShouldCheckAllFiles()
+		&& Operation.ShouldForceUpdate() == OtherOperation.ShouldForceUpdate();
+}
+
+ECommandResult::Type FDiversionProvider::CoalesceStatusCommand(FDiversionCommand* InCommand)
+{
+	// Paths already queried by an issued request - complete together with it
+	for (auto& [InFlightCommand, InFlightPaths] : InFlightStatusCommands)
+	{
+		if (HaveSameStatusFlags(*InCommand, *InFlightCommand) &&
+			Algo::AllOf(InCommand->Files, [&InFlightPaths](const FString& Path) { return InFlightPaths.Contains(Path); }))
+		{
+			InFlightCommand->CoalescedOperations.Add({ InCommand->Operation, InCommand->OperationCompleteDelegate });
+			delete InCommand;
+			return ECommandResult::Succeeded;
+		}
+	}
+
+	const EDiversionCommandLane::Type Lane = InCommand->Worker->GetLane(*InCommand);
+	auto* Pending = PendingStatusCommands.FindByPredicate([InCommand](const TPair<FDiversionCommand*, FDiversionPathPrefixSet>& PendingCommand) {
+		return HaveSameStatusFlags(*InCommand, *PendingCommand.Key);
+	});
+	if (Pending == nullptr)
+	{
+		InCommand->LaneOverride = Lane;
+		PendingStatusCommands.Emplace(InCommand, FDiversionPathPrefixSet(InCommand->Files));
+		return ECommandResult::Succeeded;
+	}
+
+	// Merge into this frame's request. The status query is scoped by the union of the paths -
+	// once the repo path is in, it's a single repo wide query serving everyone
+	auto& [PendingCommand, PendingPaths] = *Pending;
+	for (FString& Path : InCommand->Files)
+	{
+		if (!PendingPaths.Contains(Path))
+		{
+			PendingPaths.Add(Path);
+			PendingCommand->Files.Add(MoveTemp(Path));
+		}
+	}
+	// Lanes are ordered by priority, keep the most urgent one of the merged requests
+	PendingCommand->LaneOverride = FMath::Min(PendingCommand->LaneOverride.GetValue(), Lane);
+	PendingCommand->CoalescedOperations.Add({ InCommand->Operation, InCommand->OperationCompleteDelegate });
+	delete InCommand;
+	return ECommandResult::Succeeded;
+}
+
+void FDiversionProvider::IssuePendingStatusCommands()
+{
+	TArray<TPair<FDiversionCommand*, FDiversionPathPrefixSet>> Commands = MoveTemp(PendingStatusCommands);
+	PendingStatusCommands.Reset();
+	for (auto& [Command, Paths] : Commands)
+	{
+		InFlightStatusCommands.Add(Command, MoveTemp(Paths));
+		IssueCommand(*Command);
+	}
+}
+
 bool FDiversionProvider::CanExecuteOperation(const FSourceControlOperationRef& InOperation) const
 {
 	return WorkersMap.Find(InOperation->GetName()) != nullptr;
@@ -949,11 +1431,15 @@ bool FDiversionProvider::CanExecuteOperation(const FSourceControlOperationRef& I
 
 bool FDiversionProvider::CanCancelOperation(const FSourceControlOperationRef& InOperation) const
 {
-	return false;
+	return InOperation->GetName() == "GetPotentialClashes";
 }
 
 void FDiversionProvider::CancelOperation(const FSourceControlOperationRef& InOperation)
 {
+	if (CanCancelOperation(InOperation))
+	{
+		StaticCastSharedRef<FGetPotentialClashes>(InOperation)->Cancel();
+	}
 }
 
 bool FDiversionProvider::UsesLocalReadOnlyState() const
@@ -1036,6 +1522,11 @@ void FDiversionProvider::RegisterWorker(const FName& InName, const FGetDiversion
 	WorkersMap.Add(InName, InDelegate);
 }
 
+void FDiversionProvider::UnregisterWorker(const FName& InName)
+{
+	WorkersMap.Remove(InName);
+}
+
 void FDiversionProvider::OutputCommandMessages(const FDiversionCommand& InCommand)
 {
 	FMessageLog SourceControlLog("SourceControl");
@@ -1058,48 +1549,175 @@ void FDiversionProvider::OutputCommandMessages(const FDiversionCommand& InComman
 
 void FDiversionProvider::Tick()
 {
+	UpdateAgentEventSubscription();
+	HandleAgentEvents();
 
-	// Revalidate the agent status and WsInfo
+	// Revalidate the agent status and WsInfo - the events subscription only replaces the workspace status polling
+	if (AgentEvents.IsValid())
+	{
+		AgentEvents->RefreshAgentVersion(DvVersion);
+	}
 	IsAgentAlive(EConcurrency::Asynchronous, ReloadStatusRequired);
 	GetWsInfo(EConcurrency::Asynchronous, ReloadStatusRequired);
 	if(ReloadStatusRequired)
 	{
 		ReloadStatusRequired = false;
 	}
+	// Also for the snapshot readers that don't go through a command
+	GetRevalidatedSnapshot();
+
+	IssueOverflowCommands();
+	IssuePendingStatusCommands();
+
+	FinalizeCompletedCommands(GetDiversionCommandCompletionBudgetSeconds());
+	BroadcastStateChanges();
 
-	bool bStatesUpdated = false;
-	for (int32 CommandIndex = 0; CommandIndex < CommandQueue.Num(); ++CommandIndex)
+	EvictStatesIfNeeded();
+}
+
+void FDiversionProvider::BroadcastStateChanges()
+{
+	if (!bBroadcastPending)
 	{
-		FDiversionCommand& Command = *CommandQueue[CommandIndex];
-		if (Command.bExecuteProcessed)
+		return;
+	}
+	// Listeners might update states themselves, those are broadcast on the next Tick
+	bBroadcastPending = false;
+	OnSourceControlStateChanged.Broadcast();
+}
+
+bool FDiversionProvider::IsReceivingAgentEvents() const
+{
+	return AgentEvents.IsValid() && AgentEvents->IsConnected();
+}
+
+void FDiversionProvider::UpdateAgentEventSubscription()
+{
+	if (bDiversionStopped || BackgroundStatus == nullptr)
+	{
+		return;
+	}
+
+	// WsInfo is transiently reset while being revalidated, only a valid different workspace replaces the subscription
+	const WorkspaceInfo& CurrentWsInfo = WsInfo.Get();
+	if (CurrentWsInfo.IsValid() && (!AgentEvents.IsValid() || AgentEvents->GetWorkspaceID() != CurrentWsInfo.WorkspaceID))
+	{
+		if (AgentEvents.IsValid())
 		{
-			// Remove command from the queue
-			CommandQueue.RemoveAt(CommandIndex);
+			AgentEvents->RequestStop();
+		}
 
-			// let command update the states of any files
-			bStatesUpdated |= Command.Worker->UpdateStates();
+		// A dedicated client, the long poll holds its connection open
+		auto AgentApiClient = MakeShared<DiversionHttp::FHttpRequestManager>(AGENT_API_HOST, AGENT_API_PORT,
+			DiversionUtils::GetDiversionHeaders(), false);
+		AgentEvents = MakeShared<FDiversionAgentEventSubscription, ESPMode::ThreadSafe>(MakeShared<Diversion::AgentAPI::DefaultApi>(AgentApiClient),
+			CurrentWsInfo.RepoID, CurrentWsInfo.WorkspaceID, CurrentWsInfo.GetPath());
+		AgentEvents->Start();
+	}
 
-			// dump any messages to output log
-			OutputCommandMessages(Command);
+	// Older agents (or a disconnected agent) fall back to polling the workspace status
+	if (IsReceivingAgentEvents())
+	{
+		BackgroundStatus->Stop();
+	}
+	else
+	{
+		BackgroundStatus->Start();
+	}
+}
 
-			Command.ReturnResults();
+void FDiversionProvider::HandleAgentEvents()
+{
+	if (!AgentEvents.IsValid())
+	{
+		return;
+	}
+
+	TArray<FDiversionAgentEvent> Events;
+	AgentEvents->ConsumeEvents(Events);
+	if (Events.IsEmpty())
+	{
+		return;
+	}
 
-			// commands that are left in the array during a tick need to be deleted
-			if (Command.bAutoDelete)
+	bool bFullStatusRequired = false;
+	TSet<FString> ChangedPaths;
+	for (const FDiversionAgentEvent& Event : Events)
+	{
+		switch (Event.Type)
+		{
+		case FDiversionAgentEvent::EType::FilesChanged:
+			ChangedPaths.Append(Event.Paths);
+			break;
+		case FDiversionAgentEvent::EType::SyncProgress:
+			SetSyncStatus(Event.bIsPaused ? DiversionUtils::EDiversionWsSyncStatus::Paused
+				: Event.bIsSyncComplete ? DiversionUtils::EDiversionWsSyncStatus::Completed
+				: DiversionUtils::EDiversionWsSyncStatus::InProgress);
+			if (Event.bIsSyncComplete)
 			{
-				// Only delete commands that are not running 'synchronously'
-				delete &Command;
+				// The sync might have resolved (or brought in) conflicts
+				BackgroundConflictedFiles->TriggerInstantCallAndReset();
 			}
+			break;
+		case FDiversionAgentEvent::EType::WorkspaceSwitched:
+			SetReloadStatus();
+			bFullStatusRequired = true;
+			break;
+		case FDiversionAgentEvent::EType::Resync:
+			bFullStatusRequired = true;
+			break;
+		}
+	}
+
+	if (bFullStatusRequired)
+	{
+		BackgroundStatusTriggerInstantCall();
+	}
+	else if (!ChangedPaths.IsEmpty())
+	{
+		const auto Operation = ISourceControlOperation::Create<FUpdateStatus>();
+		Execute(Operation, nullptr, ChangedPaths.Array(), EConcurrency::Asynchronous);
+	}
+}
 
-			// only do one command per tick loop, as we don't want concurrent modification
-			// of the command queue (which can happen in the completion delegate)
+void FDiversionProvider::FinalizeCompletedCommands(double BudgetSeconds)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	FDiversionCommand* CompletedCommand = nullptr;
+	// Completion delegates might issue (or even synchronously run) new commands, the queue handles it
+	// since only the game thread ever dequeues
+	while (CompletedCommands.Dequeue(CompletedCommand))
+	{
+		FinalizeCommand(*CompletedCommand);
+		if (FPlatformTime::Seconds() - StartTime >= BudgetSeconds)
+		{
 			break;
 		}
 	}
+}
 
-	if (bStatesUpdated)
+void FDiversionProvider::FinalizeCommand(FDiversionCommand& InCommand)
+{
+	NumPendingCommands--;
+	// Requests issued from here on (e.g. from the completion delegates) need fresh data
+	InFlightStatusCommands.Remove(&InCommand);
+
+	// let command update the states of any files
+	if (InCommand.Worker->UpdateStates())
 	{
-		OnSourceControlStateChanged.Broadcast();
+		MarkStatesChanged();
+	}
+
+	// dump any messages to output log
+	OutputCommandMessages(InCommand);
+
+	InCommand.ReturnResults();
+	InCommand.bFinalized = true;
+
+	// Only delete commands that are not running 'synchronously', those are deleted by ExecuteSynchronousCommand
+	if (InCommand.bAutoDelete)
+	{
+		delete &InCommand;
 	}
 }
 
@@ -1133,21 +1751,22 @@ ECommandResult::Type FDiversionProvider::ExecuteSynchronousCommand(FDiversionCom
 		// Issue the command asynchronously...
 		IssueCommand(InCommand);
 
-		// ... then wait for its completion (thus making it synchronous)
-		while (!InCommand.bExecuteProcessed)
+		// ... then wait for it to be finalized by Tick(), which also finalizes any other completed command
+		while (!InCommand.bFinalized)
 		{
 			// Tick the command queue and update progress.
 			Tick();
 
 			Progress.Tick();
 
-			// Sleep for a bit so we don't busy-wait so much.
-			FPlatformProcess::Sleep(0.01f);
+			// Sleep until a command completes - the timeout only keeps the progress dialog responsive.
+			// Don't wait if completions are left over from a Tick() that ran out of budget, the event was already consumed
+			if (!InCommand.bFinalized && CompletedCommands.IsEmpty())
+			{
+				CommandCompletedEvent->Wait(MILLISECONDS_SYNCHRONOUS_COMMAND_PROGRESS_TICK);
+			}
 		}
 
-		// always do one more Tick() to make sure the command queue is cleaned up.
-		Tick();
-
 		if (InCommand.bCommandSuccessful)
 		{
 			Result = ECommandResult::Succeeded;
@@ -1160,11 +1779,6 @@ ECommandResult::Type FDiversionProvider::ExecuteSynchronousCommand(FDiversionCom
 		return Result;
 	}
 
-	// ensure commands that are not auto deleted do not end up in the command queue
-	if (CommandQueue.Contains(&InCommand))
-	{
-		CommandQueue.Remove(&InCommand);
-	}
 	delete &InCommand;
 
 	return Result;
@@ -1172,30 +1786,144 @@ ECommandResult::Type FDiversionProvider::ExecuteSynchronousCommand(FDiversionCom
 
 ECommandResult::Type FDiversionProvider::IssueCommand(FDiversionCommand& InCommand)
 {
-	if (GThreadPool != nullptr && CommandQueue.Num() < GThreadPool->GetNumThreads())
+	if (!CommandScheduler.IsValid())
 	{
-		// Queue this to our worker thread(s) for resolving
-		GThreadPool->AddQueuedWork(&InCommand);
-		CommandQueue.Add(&InCommand);
-		return ECommandResult::Succeeded;
+		CommandScheduler = MakeUnique<FDiversionCommandScheduler>(GetDiversionCommandThreads(), MAX_QUEUED_BACKGROUND_COMMANDS);
 	}
-	else
+
+	// The game thread is blocked on synchronous commands, never let them wait behind background work
+	EDiversionCommandLane::Type Lane = InCommand.LaneOverride.IsSet() ? InCommand.LaneOverride.GetValue() : InCommand.Worker->GetLane(InCommand);
+	if (InCommand.GetConcurrency() == EConcurrency::Synchronous)
 	{
-		FText Message(
-            FText::Format(LOCTEXT("NoSCCThreads", "There are no threads available to process the revision control command: {0}."), FText::FromName(InCommand.Worker->GetName()))
-		);
-		FMessageLog("SourceControl").Error(Message);
-		InCommand.Operation->AddErrorMessge(Message);
-		UE_LOG(LogSourceControl, Error, TEXT("There are no threads available to process the revision control command: %s."), *(InCommand.Worker->GetName().ToString()));
-		
-		int availableThreads = (GThreadPool != nullptr) ? GThreadPool->GetNumThreads() : 0;
-		UE_LOG(LogSourceControl, Error, TEXT("There are currently %d active worker threads out of: %d"), CommandQueue.Num(), availableThreads);
-		for (auto& cmd : CommandQueue) {
-			UE_LOG(LogSourceControl, Error, TEXT("% s"), *(cmd->Worker->GetName().ToString()));
+		Lane = EDiversionCommandLane::Interactive;
+	}
+
+	// Queue this to our worker thread(s) for resolving
+	InCommand.CompletionQueue = &CompletedCommands;
+	InCommand.CompletionEvent = CommandCompletedEvent.Get();
+	NumPendingCommands++;
+	// Don't let a command overtake the ones already waiting for room, Tick() issues them in order
+	const bool bMustWait = Lane != EDiversionCommandLane::Interactive && !OverflowCommands.IsEmpty();
+	if (bMustWait || !CommandScheduler->TryEnqueue(InCommand, Lane))
+	{
+		if (OverflowCommands.IsEmpty())
+		{
+			UE_LOG(LogSourceControl, Warning, TEXT("Diversion command queue is full (%d commands), holding %s command %s until there's room"),
+				MAX_QUEUED_BACKGROUND_COMMANDS, EDiversionCommandLane::ToString(Lane), *InCommand.Worker->GetName().ToString());
+		}
+		OverflowCommands.Emplace(&InCommand, Lane);
+	}
+	return ECommandResult::Succeeded;
+}
+
+void FDiversionProvider::IssueOverflowCommands()
+{
+	int32 NumIssued = 0;
+	while (NumIssued < OverflowCommands.Num() && CommandScheduler->TryEnqueue(*OverflowCommands[NumIssued].Key, OverflowCommands[NumIssued].Value))
+	{
+		++NumIssued;
+	}
+	OverflowCommands.RemoveAt(0, NumIssued);
+}
+
+FDiversionCommandLaneStats FDiversionProvider::GetCommandLaneStats(EDiversionCommandLane::Type InLane) const
+{
+	return CommandScheduler.IsValid() ? CommandScheduler->GetLaneStats(InLane) : FDiversionCommandLaneStats();
+}
+
+void FDiversionProvider::IssueBackgroundStatus()
+{
+	const FString WorkspacePath = WsInfo.Get().GetPath();
+	const double Now = FPlatformTime::Seconds();
+	if (bFullStatusRequired || Now - LastFullStatusTime >= SECONDS_BETWEEN_FULL_STATUS || ProjectDirectoryWatcherHandles.IsEmpty())
+	{
+		bFullStatusRequired = false;
+		LastFullStatusTime = Now;
+		DirtyPaths.Empty();
+		const auto Operation = ISourceControlOperation::Create<FUpdateStatus>();
+		Execute(Operation, nullptr, { WorkspacePath }, EConcurrency::Asynchronous);
+		return;
+	}
+
+	if (DirtyPaths.IsEmpty())
+	{
+		// Nothing changed on disk, nothing to ask the agent
+		return;
+	}
+
+	// The status request is scoped to the common prefixes of the changed files, and queried files that
+	// are no longer reported (e.g. reverted) are reset to unchanged
+	TArray<FString> ChangedPaths = DirtyPaths.Array();
+	DirtyPaths.Empty();
+	const auto Operation = ISourceControlOperation::Create<FUpdateStatus>();
+	Execute(Operation, nullptr, ChangedPaths, EConcurrency::Asynchronous);
+}
+
+void FDiversionProvider::StartWatchingProjectDirectories()
+{
+	if (!FModuleManager::Get().IsModuleLoaded("DirectoryWatcher"))
+	{
+		UE_LOG(LogSourceControl, Log, TEXT("DirectoryWatcher module is not loaded, the background status scans the whole workspace"));
+		return;
+	}
+
+	IDirectoryWatcher* DirectoryWatcher = FModuleManager::LoadModuleChecked<FDirectoryWatcherModule>("DirectoryWatcher").Get();
+	for (const FString& Directory : { FPaths::ProjectContentDir(), FPaths::ProjectConfigDir(), FPaths::GameSourceDir() })
+	{
+		const FString FullDirectory = FPaths::ConvertRelativePathToFull(Directory);
+		if (ProjectDirectoryWatcherHandles.Contains(FullDirectory) || !FPaths::DirectoryExists(FullDirectory))
+		{
+			continue;
 		}
 
-		InCommand.MarkOperationCompleted(false);
-		return ECommandResult::Cancelled;
+		FDelegateHandle Handle;
+		if (DirectoryWatcher->RegisterDirectoryChangedCallback_Handle(FullDirectory,
+			IDirectoryWatcher::FDirectoryChanged::CreateRaw(this, &FDiversionProvider::OnProjectFilesChanged), Handle))
+		{
+			ProjectDirectoryWatcherHandles.Add(FullDirectory, Handle);
+		}
+	}
+}
+
+void FDiversionProvider::StopWatchingProjectDirectories()
+{
+	if (!ProjectDirectoryWatcherHandles.IsEmpty() && FModuleManager::Get().IsModuleLoaded("DirectoryWatcher"))
+	{
+		IDirectoryWatcher* DirectoryWatcher = FModuleManager::LoadModuleChecked<FDirectoryWatcherModule>("DirectoryWatcher").Get();
+		for (const auto& [Directory, Handle] : ProjectDirectoryWatcherHandles)
+		{
+			DirectoryWatcher->UnregisterDirectoryChangedCallback_Handle(Directory, Handle);
+		}
+	}
+	ProjectDirectoryWatcherHandles.Empty();
+	DirtyPaths.Empty();
+	bFullStatusRequired = true;
+}
+
+void FDiversionProvider::OnProjectFilesChanged(const TArray<FFileChangeData>& InFileChanges)
+{
+	if (bFullStatusRequired)
+	{
+		// The next status scans everything anyway
+		return;
+	}
+
+	const FString WorkspacePath = WsInfo.Get().GetPath();
+	for (const FFileChangeData& Change : InFileChanges)
+	{
+		FString ChangedPath = FPaths::ConvertRelativePathToFull(Change.Filename);
+		FPaths::NormalizeFilename(ChangedPath);
+		if (FPaths::IsUnderDirectory(ChangedPath, WorkspacePath))
+		{
+			DirtyPaths.Add(MoveTemp(ChangedPath));
+		}
+	}
+
+	if (DirtyPaths.Num() > MAX_WATCHED_DIRTY_PATHS)
+	{
+		// A scan of the whole workspace is cheaper than a huge list of paths
+		DirtyPaths.Empty();
+		bFullStatusRequired = true;
 	}
 }
 
@@ -1308,6 +2036,12 @@ void FDiversionProvider::OnPackageSave(const FString& PackageFileName, UObject*)
 {
 	const FString FileName = FPaths::ConvertRelativePathToFull(PackageFileName);
 
+	// The user is active, keep the status fresh
+	if (BackgroundStatus.IsValid())
+	{
+		BackgroundStatus->ResetBackoff();
+	}
+
 	// After a file resolve operation is called, after the file was saved we need to
 	// trigger a Diversion Resolve operation on it
 	// If we left with 0 files to resolve, we can finalize the merge 
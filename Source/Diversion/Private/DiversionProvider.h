@@ -8,9 +8,14 @@
 #include "DiversionVersion.h"
 #include "CachedState.h"
 #include "DiversionChangelistState.h"
+#include "DiversionProviderSnapshot.h"
 #include "DiversionTimedDelegate.h"
 #include "CustomWidgets/NotificationManager.h"
 #include "IDirectoryWatcher.h"
+#include "DiversionAgentEvents.h"
+#include "DiversionPathPrefixSet.h"
+#include "Containers/Queue.h"
+#include "HAL/Event.h"
 
 class FDiversionState;
 
@@ -18,16 +23,60 @@ class FDiversionCommand;
 
 DECLARE_DELEGATE_RetVal(FDiversionWorkerRef, FGetDiversionWorker)
 
+/** Snapshot of the state cache counters, see FDiversionProvider::GetStateCacheStats */
+struct FDiversionStateCacheStats
+{
+	/** Number of states currently cached */
+	int32 Num = 0;
+	/** Number of GetStateInternal lookups that found a cached state */
+	uint64 Hits = 0;
+	/** Number of GetStateInternal lookups that had to create a new state */
+	uint64 Misses = 0;
+	/** Total number of states evicted since the provider was created */
+	uint64 Evictions = 0;
+	/** Number of eviction passes that ran since the provider was created */
+	uint64 EvictionPasses = 0;
+
+	double GetHitRate() const
+	{
+		const uint64 Lookups = Hits + Misses;
+		return Lookups > 0 ? static_cast<double>(Hits) / static_cast<double>(Lookups) : 0.0;
+	}
+};
+
+/** Keys cached states by their own LocalFilename, so the cache and its indexes don't hold another copy of every path */
+struct FDiversionStateKeyFuncs : BaseKeyFuncs<TSharedRef<FDiversionState>, FString>
+{
+	static const FString& GetSetKey(const TSharedRef<FDiversionState>& Element)
+	{
+		return Element->LocalFilename;
+	}
+
+	/** Same path comparison as a TMap<FString, ...> */
+	static bool Matches(const FString& A, const FString& B)
+	{
+		return A == B;
+	}
+
+	static uint32 GetKeyHash(const FString& Key)
+	{
+		return GetTypeHash(Key);
+	}
+};
+
+using FDiversionStateSet = TSet<TSharedRef<FDiversionState>, FDiversionStateKeyFuncs>;
+
 
 class FDiversionProvider : public ISourceControlProvider
 {
 public:
-	FDiversionProvider() : DvVersion(FDiversionVersion(""), FTimespan::FromSeconds(3)),
+	FDiversionProvider() : DvVersion(FDiversionVersion(""), FTimespan::FromSeconds(3), FTimespan::FromSeconds(30)),  // No answer for long - agent state unknown
 	                       WsInfo(WorkspaceInfo(), FTimespan::FromSeconds(3)),
 	                       SyncStatus(DiversionUtils::EDiversionWsSyncStatus::Paused, FTimespan::FromSeconds(1)),
 						   bRepoWithSameNameExists(false, FTimespan::FromSeconds(15)),  // BE call - slow interval
 						   bWorkspaceExistsInPath(false, FTimespan::FromSeconds(2)),
-						   ChangelistState(MakeShared<FDiversionChangelistState>())
+						   ChangelistState(MakeShared<FDiversionChangelistState>()),
+						   Snapshot(MakeShared<const FDiversionProviderSnapshot, ESPMode::ThreadSafe>())
 	{
 	}
 
@@ -76,8 +125,8 @@ public:
 	bool CheckDiversionAvailability();
 
 	/** Diversion version for feature checking */
-	const FDiversionVersion& GetDiversionVersion(EConcurrency::Type Concurrency, bool InForceUpdate);
-	const FDiversionVersion& GetDiversionVersion() const;
+	FDiversionVersion GetDiversionVersion(EConcurrency::Type Concurrency, bool InForceUpdate);
+	FDiversionVersion GetDiversionVersion() const;
 
 	bool IsAgentAlive(EConcurrency::Type Concurrency, bool InForceUpdate){
 		return GetDiversionVersion(Concurrency, InForceUpdate).IsValid();
@@ -134,9 +183,18 @@ public:
 	 */
 	void RegisterWorker(const FName& InName, const FGetDiversionWorker& InDelegate);
 
+	/** Removes a worker added with RegisterWorker() */
+	void UnregisterWorker(const FName& InName);
+
 	/** Remove a named file from the state cache */
 	bool RemoveFileFromCache(const FString& Filename);
 
+	/** Has OnSourceControlStateChanged broadcast on the next Tick, for states updated outside of the provider */
+	void MarkStatesChanged()
+	{
+		bBroadcastPending = true;
+	}
+
 	FString GetRepositoryId() const
 	{
 		return WsInfo.Get().RepoID;
@@ -194,6 +252,34 @@ private:
 	/** Issue a command asynchronously if possible. */
 	ECommandResult::Type IssueCommand(class FDiversionCommand& InCommand);
 
+	/**
+	 * Finalizes completed commands on the game thread until the time budget is spent.
+	 * At least one command is finalized per call, so a tight budget can't stall the queue.
+	 * The states they change are broadcast once by the next BroadcastStateChanges().
+	 */
+	void FinalizeCompletedCommands(double BudgetSeconds);
+
+	/** Updates the states, outputs the messages and returns the results of a completed command */
+	void FinalizeCommand(class FDiversionCommand& InCommand);
+
+	/** Asynchronous plain status requests (no history) can be served by another status request */
+	static bool IsCoalescableStatusCommand(const class FDiversionCommand& InCommand);
+
+	/** Status requests only serve each other when they ask for the same data - all their FUpdateStatus flags match */
+	static bool HaveSameStatusFlags(const class FDiversionCommand& InCommand, const class FDiversionCommand& InOtherCommand);
+
+	/**
+	 * Serves the status request by a request already issued for all of its paths (or their directories), or merges it
+	 * into the pending status request with the same flags, issued on the next Tick(). Takes ownership of the command.
+	 */
+	ECommandResult::Type CoalesceStatusCommand(class FDiversionCommand* InCommand);
+
+	/** Issues the status requests the requests of the last frame were merged into */
+	void IssuePendingStatusCommands();
+
+	/** Hands the commands parked by IssueCommand() to the scheduler, in issue order, while its queues have room */
+	void IssueOverflowCommands();
+
 	/** Output any messages this command holds */
 	void OutputCommandMessages(const class FDiversionCommand& InCommand);
 
@@ -208,12 +294,43 @@ private:
 	/** The currently registered version control operations */
 	TMap<FName, FGetDiversionWorker> WorkersMap;
 
-	/** Queue for commands given by the main thread */
-	TArray<FDiversionCommand*> CommandQueue;
+	/** Number of issued commands that were not finalized yet */
+	int32 NumPendingCommands = 0;
+
+	/** Background and bulk commands issued while the scheduler queues were full, see IssueOverflowCommands */
+	TArray<TPair<class FDiversionCommand*, EDiversionCommandLane::Type>> OverflowCommands;
+
+	/** Commands done running, pushed by the worker threads and finalized by Tick() */
+	TQueue<FDiversionCommand*, EQueueMode::Mpsc> CompletedCommands;
+
+	/** Triggered whenever a command is pushed to CompletedCommands, so synchronous commands don't have to poll */
+	FEventRef CommandCompletedEvent;
+
+	/**
+	 * Status requests collecting the asynchronous status requests of the current frame, one per set of flags, issued on the
+	 * next Tick(). The requests are merged by path - paths under a requested directory are left out, so a repo wide request
+	 * makes it a single full status query
+	 */
+	TArray<TPair<FDiversionCommand*, FDiversionPathPrefixSet>> PendingStatusCommands;
+
+	/** Issued status requests (with their paths), still able to serve requests for the same paths until finalized */
+	TMap<FDiversionCommand*, FDiversionPathPrefixSet> InFlightStatusCommands;
+
+	/** Subscription to the workspace events of the agent, replaces the status polling while connected */
+	TSharedPtr<FDiversionAgentEventSubscription, ESPMode::ThreadSafe> AgentEvents;
+
+	/** Dedicated prioritized thread pool running the commands, created on first use */
+	TUniquePtr<FDiversionCommandScheduler> CommandScheduler;
 
 	/** For notifying when the version control states in the cache have changed */
 	FSourceControlStateChanged OnSourceControlStateChanged;
 
+	/** A state changed since the last broadcast, nothing is broadcast otherwise */
+	bool bBroadcastPending = false;
+
+	/** Broadcasts OnSourceControlStateChanged if a state changed since the last call */
+	void BroadcastStateChanges();
+
 	TCached<FDiversionVersion> DvVersion;
 	TCached<WorkspaceInfo> WsInfo;
 	TCached<DiversionUtils::EDiversionWsSyncStatus> SyncStatus;
@@ -284,13 +401,19 @@ private:
 	
 #pragma region StatesCache
 public:
+
+	/**
+	 * GetCachedStateByPredicate() for the callers only looking for changed files: only visits the indexed states -
+	 * changed (see IsCleanWorkingCopyState), conflicted, potentially clashed or syncing - never the clean bulk of the cache.
+	 */
+	TArray<FSourceControlStateRef> GetChangedStatesByPredicate(TFunctionRef<bool(const FSourceControlStateRef&)> Predicate) const;
 	
 	/**
 	 * Helper function for various commands to update cached states.
 	 * @param InNewStates - new states to update the cache with
 	 * @param IsFullStatusUpdate - if true, this will clear the modified states cache
 	 * @param InConflictedFiles - Conflicted paths to update the states of
-	 * @returns true if any states were updated
+	 * @returns true if any cached state actually changed
 	 */
 	bool UpdateCachedStates(const TMap<FString, FDiversionState>& InNewStates, bool IsFullStatusUpdate);
 
@@ -315,12 +438,6 @@ public:
 	 * @return The resolve information for the specified file.
 	 */
 	TUniquePtr<FDiversionResolveInfo> GetFileResolveInfo(const FString& Path) const;
-	/**
-	 * Helper function to get the paths values of conflicted files.
-	 * @param OutArray - Array to fill with the conflicted files paths
-	 */
-	void GetConflictedFilesPaths(TArray<FString>& OutArray) const;
-	
 	void SetFilesToResolve(const TMap<FString, FDiversionResolveInfo>& InFilesToResolve);
 	/**
 	 * Helper function for various commands to update states with their potential clashes status.
@@ -330,12 +447,39 @@ public:
 	 */
 	bool UpdatePotentialClashedStates(const TMap<FString, TArray<EDiversionPotentialClashInfo>>& InPotentialClashes,
 		bool IsFullStatusUpdate);
-	
-	void GetCurrentPotentialClashes(TArray<FString>& OutPotentialClashedPaths) const;
+
+	/**
+	 * Latest published snapshot of the provider state (WsInfo, sync status, conflicted and clashed paths).
+	 * Safe to call from any thread - the snapshot itself is immutable.
+	 */
+	FDiversionProviderSnapshotRef GetSnapshot() const;
+
+	/**
+	 * GetSnapshot(), after bringing the agent status up to date with its hard expiry.
+	 * The WsInfo and the path sets are published as they're set, only the agent status can go stale on its own.
+	 * Game thread only.
+	 */
+	FDiversionProviderSnapshotRef GetRevalidatedSnapshot();
+
+	/**
+	 * Records the fingerprint of the full repo status the states cache now matches, see IDiversionStatusWorker.
+	 * A status with the same fingerprint is then skipped. Pass 0 whenever the cache was updated from anything else.
+	 */
+	void SetStatusFingerprint(uint32 InFingerprint);
+
 	
 	/** Helper function used to update state cache */
 	TSharedRef<FDiversionState, ESPMode::ThreadSafe> GetStateInternal(const FString& Filename);
 
+	/** Size, hit rate and eviction counters of the state cache */
+	FDiversionStateCacheStats GetStateCacheStats() const;
+
+	/** Queue depth, wait and execution time counters of a command lane */
+	FDiversionCommandLaneStats GetCommandLaneStats(EDiversionCommandLane::Type InLane) const;
+
+	/** Number of commands waiting for room in the scheduler queues */
+	int32 GetNumOverflowCommands() const { return OverflowCommands.Num(); }
+
 	/** Adds a state to the synching states cache */
 	void AddSyncingState(const FString& Path, const TSharedRef<class FDiversionState>& InState);
 
@@ -345,9 +489,18 @@ public:
 	{
 		BackgroundStatus->SkipToNextInterval();
 	}
+	// Use when a BG status poll was handled without updating the states, see FTimedDelegateWrapper::ReportPollResult
+	void BackgroundStatusReportPollResult(bool bInChanged)
+	{
+		BackgroundStatus->ReportPollResult(bInChanged);
+		BackgroundStatus->SkipToNextInterval();
+	}
 	// Force trigger calling BG status on the next tick
 	void BackgroundStatusTriggerInstantCall()
 	{
+		// Whatever asked for it (sync, workspace switch) changed files the directory watcher might not see
+		bFullStatusRequired = true;
+		SetStatusFingerprint(0);
 		BackgroundStatus->TriggerInstantCallAndReset();
 	}
 //
@@ -364,9 +517,77 @@ private:
 
 	/** Adds a state to the modified states cache */
 	void AddModifiedState(const TSharedRef<class FDiversionState>& InState);
+
+	/** Sets the working copy state of a cached state while keeping WorkingCopyStateIndex in sync */
+	void SetCachedWorkingCopyState(const TSharedRef<FDiversionState>& InState, EWorkingCopyState::Type InWorkingCopyState);
+
+	/** Removes a cached state from all the secondary indexes */
+	void RemoveFromStateIndexes(const FString& Filename);
+
+	/**
+	 * Publishes a new snapshot built from a copy of the current one (copy-on-write).
+	 * Game thread only - the game thread is the single writer of the snapshot.
+	 */
+	void PublishSnapshot(TFunctionRef<void(FDiversionProviderSnapshot&)> InUpdate);
+
+	/** Persists the state cache, clashes and conflicts of the current workspace to disk, see DiversionStateCacheFile */
+	void SavePersistedStates() const;
+
+	/**
+	 * (Re)subscribes to the agent workspace events whenever the workspace changes, and switches the
+	 * background status polling off while the subscription is connected
+	 */
+	void UpdateAgentEventSubscription();
+
+	/** Applies the workspace events the agent pushed since the last Tick() */
+	void HandleAgentEvents();
+
+	/** True while the agent pushes the workspace changes and the workspace doesn't need to be polled */
+	bool IsReceivingAgentEvents() const;
+
+	/** Restores the states persisted by the previous session, if they still match the workspace commit */
+	void LoadPersistedStates();
+
+	/** Check if the file is under the project Config directory, resolved once per session */
+	bool IsConfigFile(const FString& FilePath);
+
+	/** Unchanged and Unknown states make up the bulk of the cache, they are left out of WorkingCopyStateIndex */
+	static bool IsCleanWorkingCopyState(EWorkingCopyState::Type InWorkingCopyState)
+	{
+		return InWorkingCopyState == EWorkingCopyState::Unchanged || InWorkingCopyState == EWorkingCopyState::Unknown;
+	}
+
+	/** True if the state holds nothing that can't be fetched again on demand and it can be dropped from the cache */
+	static bool IsEvictableState(const TSharedRef<FDiversionState>& InState, double EvictBeforeTime);
+
+	/**
+	 * Drops idle evictable states once the cache grows over the configured cap, down to a low watermark so the
+	 * pass doesn't run again on every new state. Approximates LRU with a clock sweep: each pass carries on over
+	 * the cache from where the previous one stopped, skipping the recently accessed states, and looks at no more
+	 * than STATE_CACHE_EVICTION_SCAN_LIMIT states.
+	 */
+	void EvictStatesIfNeeded();
 	
-	/** State cache */
-	TMap<FString, TSharedRef<FDiversionState>> StateCache;
+	/** State cache, keyed by the filename of the states */
+	FDiversionStateSet StateCache;
+	/**
+	 * Secondary index of the state cache by working copy state, clean states excluded (see IsCleanWorkingCopyState).
+	 * Must only be modified via SetCachedWorkingCopyState
+	 */
+	TMap<EWorkingCopyState::Type, FDiversionStateSet> WorkingCopyStateIndex;
+	/** Paths of cached states that are project config files - UE adds these to the changelists by itself */
+	TSet<FString> ConfigFileStates;
+	/** Full path to the project Config directory */
+	FString ProjectConfigDir;
+	/** State cache counters */
+	FDiversionStateCacheStats StateCacheStats;
+	/** Last time an eviction pass ran, used to throttle the passes */
+	double LastStateCacheEvictionTime = 0.0;
+	/** StateCache element index the next eviction pass starts at */
+	int32 StateCacheEvictionHand = 0;
+	/** Current provider state snapshot for the commands, see GetSnapshot */
+	FDiversionProviderSnapshotRef Snapshot;
+	mutable FRWLock SnapshotLock;
 	/** Tracking modified states - enables resetting the changes to apply external to UE changes too */
 	TMap<FString, TSharedRef<FDiversionState>> ModifiedStates;
 	/** Tracking potential clashes - this used to keep track of resolved potential clashes*/
@@ -376,10 +597,34 @@ private:
 	/** Tracking conflicted states - enables restting them once finished resolving/Updating conflicts data */
 	TMap<FString, TSharedRef<FDiversionState>> ConflictedStates;
 
+	/**
+	 * Abandons the commands that didn't start running - queued, held back or still collecting requests - and
+	 * cancels the running operations that support it, so closing only waits for the requests already sent
+	 */
+	void AbandonQueuedCommands();
+
+	/** Issues the periodic background status - scoped to the files changed since the previous one when possible */
+	void IssueBackgroundStatus();
+
+	/** Watches the project content, config and source directories, collecting the changed files into DirtyPaths */
+	void StartWatchingProjectDirectories();
+	void StopWatchingProjectDirectories();
+	void OnProjectFilesChanged(const TArray<FFileChangeData>& InFileChanges);
+
+	/** Watched directories and their directory watcher handles */
+	TMap<FString, FDelegateHandle> ProjectDirectoryWatcherHandles;
+	/** Files changed since the previous background status */
+	TSet<FString> DirtyPaths;
+	/** Set when DirtyPaths can't tell what changed (first status, overflow, sync, workspace switch) */
+	bool bFullStatusRequired = true;
+	double LastFullStatusTime = 0.0;
+
 // Background status triggering variables
 	TUniquePtr<FTimedDelegateWrapper> BackgroundStatus = nullptr;
 	TUniquePtr<FTimedDelegateWrapper> BackgroundPotentialClashes = nullptr;
 	TUniquePtr<FTimedDelegateWrapper> BackgroundConflictedFiles = nullptr;
+	/** The last repo wide potential clashes refresh, cancelled once a newer one is issued */
+	TWeakPtr<class FGetPotentialClashes, ESPMode::ThreadSafe> FullPotentialClashesRefresh;
 //
 
 #pragma endregion
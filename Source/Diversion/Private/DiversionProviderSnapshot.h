@@ -0,0 +1,32 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DiversionWorkspaceInfo.h"
+#include "DiversionUtils.h"
+
+typedef TSharedRef<const TSet<FString>, ESPMode::ThreadSafe> FDiversionPathSetRef;
+
+/**
+ * Immutable view of the provider state handed to commands running on worker threads.
+ * The provider never modifies a published snapshot - every change publishes a new one (copy-on-write),
+ * so commands can hold on to it without copying anything. The path set is shared between
+ * snapshots and only rebuilt when it actually changes.
+ */
+struct FDiversionProviderSnapshot
+{
+	WorkspaceInfo WsInfo;
+
+	bool IsAgentAlive = false;
+
+	DiversionUtils::EDiversionWsSyncStatus SyncStatus = DiversionUtils::EDiversionWsSyncStatus::Paused;
+
+	/** Paths of the files with a pending merge conflict */
+	FDiversionPathSetRef ConflictedFiles = MakeShared<const TSet<FString>, ESPMode::ThreadSafe>();
+
+	/** Fingerprint of the last full repo status applied to the states cache, 0 when the cache might not match it */
+	uint32 StatusFingerprint = 0;
+};
+
+typedef TSharedRef<const FDiversionProviderSnapshot, ESPMode::ThreadSafe> FDiversionProviderSnapshotRef;
@@ -7,6 +7,7 @@
 #include "Misc/Paths.h"
 #include "DiversionModule.h"
 #include "DiversionUtils.h"
+#include "DiversionConfig.h"
 #include "ScopedSourceControlProgress.h"
 
 #define LOCTEXT_NAMESPACE "Diversion"
@@ -40,7 +41,24 @@ bool FDiversionRevision::Get(FString& InOutFilename, EConcurrency::Type InConcur
 	{
 		TArray<FString> InfoMessages;
 		TArray<FString> ErrorMessages;
-		bCommandSuccessful = DiversionUtils::DownloadBlob(InfoMessages, ErrorMessages, CommitId, InOutFilename, Filename, WsInfo);
+		FDiversionBlobCache& BlobCache = FDiversionModule::Get().GetBlobCache();
+		const int64 MaxBlobCacheBytes = GetDiversionMaxBlobCacheBytes();
+		if (FileHash.IsEmpty() || MaxBlobCacheBytes <= 0)
+		{
+			bCommandSuccessful = DiversionUtils::DownloadBlob(InfoMessages, ErrorMessages, CommitId, InOutFilename, Filename, WsInfo, FileHash, FileHash.IsEmpty() ? -1 : FileSize);
+		}
+		else if (BlobCache.Fetch(FileHash, FileSize, InOutFilename))
+		{
+			bCommandSuccessful = true; // the same content was already downloaded, possibly for another commit or file
+		}
+		else
+		{
+			// Download next to the cached blobs, so admitting it is a rename
+			const FString TempFilename = BlobCache.MakeTempPath(FileHash);
+			bCommandSuccessful = DiversionUtils::DownloadBlob(InfoMessages, ErrorMessages, CommitId, TempFilename, Filename, WsInfo, FileHash, FileSize)
+				&& BlobCache.Admit(FileHash, TempFilename, InOutFilename, MaxBlobCacheBytes);
+			IFileManager::Get().Delete(*TempFilename, false, false, true);
+		}
 	}
 	return bCommandSuccessful;
 }
@@ -109,7 +127,7 @@ int32 FDiversionRevision::GetCheckInIdentifier() const
 
 int32 FDiversionRevision::GetFileSize() const
 {
-	return FileSize;
+	return static_cast<int32>(FMath::Min<int64>(FileSize, MAX_int32));
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -12,6 +12,7 @@ class FDiversionRevision : public ISourceControlRevision
 public:
 	FDiversionRevision()
 		: RevisionNumber(0)
+		, FileSize(0)
 	{
 	}
 
@@ -66,8 +67,8 @@ public:
 	/** The date this revision was made */
 	FDateTime Date;
 
-	/** The size of the file at this revision */
-	int32 FileSize;
+	/** The size of the file at this revision, GetFileSize() clamps it to the interface int32 */
+	int64 FileSize;
 
 	/** Copy of the Ws state in the time the revision data was created */
 	WorkspaceInfo WsInfo;
@@ -0,0 +1,70 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "DiversionStatCache.h"
+#include "DiversionConstants.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/ScopeRWLock.h"
+
+void FDiversionStatCache::Prefetch(const TArray<FString>& InPaths)
+{
+	TArray<FString> PathsToStat;
+	PathsToStat.Reserve(InPaths.Num());
+	{
+		FReadScopeLock Lock(StatsLock);
+		for (const FString& Path : InPaths)
+		{
+			if (!Stats.Contains(Path))
+			{
+				PathsToStat.Add(Path);
+			}
+		}
+	}
+
+	TArray<FDiversionPathStat> Results;
+	Results.SetNum(PathsToStat.Num());
+	// A handful of paths isn't worth waking up the task threads
+	const EParallelForFlags Flags = PathsToStat.Num() < MIN_PARALLEL_STAT_PATHS ? EParallelForFlags::ForceSingleThread : EParallelForFlags::BackgroundPriority;
+	ParallelFor(PathsToStat.Num(), [&PathsToStat, &Results](int32 Index)
+	{
+		Results[Index] = Stat(PathsToStat[Index]);
+	}, Flags);
+
+	FWriteScopeLock Lock(StatsLock);
+	Stats.Reserve(Stats.Num() + PathsToStat.Num());
+	for (int32 Index = 0; Index < PathsToStat.Num(); ++Index)
+	{
+		Stats.Add(MoveTemp(PathsToStat[Index]), Results[Index]);
+	}
+}
+
+FDiversionPathStat FDiversionStatCache::Get(const FString& InPath)
+{
+	{
+		FReadScopeLock Lock(StatsLock);
+		if (const FDiversionPathStat* Cached = Stats.Find(InPath))
+		{
+			return *Cached;
+		}
+	}
+
+	const FDiversionPathStat PathStat = Stat(InPath);
+	FWriteScopeLock Lock(StatsLock);
+	Stats.Add(InPath, PathStat);
+	return PathStat;
+}
+
+FDiversionPathStat FDiversionStatCache::Stat(const FString& InPath)
+{
+	// Existence, type and timestamp in one call
+	const FFileStatData StatData = FPlatformFileManager::Get().GetPlatformFile().GetStatData(*InPath);
+
+	FDiversionPathStat Result;
+	if (StatData.bIsValid)
+	{
+		Result.bExists = true;
+		Result.bIsDirectory = StatData.bIsDirectory;
+		Result.TimeStamp = StatData.ModificationTime;
+	}
+	return Result;
+}
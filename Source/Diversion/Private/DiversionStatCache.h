@@ -0,0 +1,41 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+/** File system state of a path, see FDiversionStatCache */
+struct FDiversionPathStat
+{
+	bool bExists = false;
+	bool bIsDirectory = false;
+	/** Last modification time, FDateTime::MinValue() if the path doesn't exist */
+	FDateTime TimeStamp = FDateTime::MinValue();
+};
+
+/**
+ * File system state of the paths of a command, a single stat per path.
+ * The paths are stat'ed up front in parallel, so the existence, type and timestamp checks of
+ * the command don't each cost a serial syscall. Paths that weren't prefetched are stat'ed on demand.
+ * Thread safe, the steps of a command running in parallel share it.
+ */
+class FDiversionStatCache
+{
+public:
+	/** Stats all the paths not cached yet, in parallel */
+	void Prefetch(const TArray<FString>& InPaths);
+
+	FDiversionPathStat Get(const FString& InPath);
+
+	bool Exists(const FString& InPath) { return Get(InPath).bExists; }
+	bool IsDirectory(const FString& InPath) { return Get(InPath).bIsDirectory; }
+	FDateTime GetTimeStamp(const FString& InPath) { return Get(InPath).TimeStamp; }
+
+private:
+	static FDiversionPathStat Stat(const FString& InPath);
+
+private:
+	mutable FRWLock StatsLock;
+	TMap<FString, FDiversionPathStat> Stats;
+};
@@ -9,51 +9,145 @@
 
 #define LOCTEXT_NAMESPACE "Diversion.State"
 
-PRAGMA_DISABLE_DEPRECATION_WARNINGS
+namespace
+{
+	FDiversionStateSideData* CloneSideData(const FDiversionStateSideData* InSideData)
+	{
+		if (InSideData == nullptr)
+		{
+			return nullptr;
+		}
+
+		FReadScopeLock Lock(InSideData->Lock);
+		FDiversionStateSideData* NewSideData = new FDiversionStateSideData();
+		NewSideData->History = InSideData->History;
+		NewSideData->PendingResolveInfo = InSideData->PendingResolveInfo;
+		NewSideData->PotentialClashes = InSideData->PotentialClashes;
+		NewSideData->OpaqueHash = InSideData->OpaqueHash;
+		return NewSideData;
+	}
+
+	bool IsLowerHexDigest(const FString& InHash, int32 DigestSize)
+	{
+		if (InHash.Len() != DigestSize * 2)
+		{
+			return false;
+		}
+		for (const TCHAR Char : InHash)
+		{
+			if (!FChar::IsHexDigit(Char) || FChar::IsUpper(Char))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
 
-void PotentialClashesList::ResetPotentialClashes()
+FDiversionState::~FDiversionState()
 {
-	FWriteScopeLock Lock(*PotentialClashesRWLock);
-	PotentialClashes.Empty();
+	delete SideData.load(std::memory_order_acquire);
 }
 
-void PotentialClashesList::SetPotentialClashes(const TArray<EDiversionPotentialClashInfo>& InPotentialClashes)
+FDiversionState::FDiversionState(const FDiversionState& Other)
+	: LocalFilename(Other.LocalFilename)
+	, TimeStamp(Other.TimeStamp)
+	, LastAccessTime(Other.LastAccessTime)
+	, LocalRevNumber(Other.LocalRevNumber)
+	, WorkingCopyState(Other.WorkingCopyState)
+	, IsSyncing(Other.IsSyncing)
+	, PotentialClashesVersion(Other.PotentialClashesVersion)
+	, SideData(CloneSideData(Other.GetSideData()))
 {
-	FWriteScopeLock Lock(*PotentialClashesRWLock);
-	PotentialClashes = InPotentialClashes;
+	CopyHash(Other);
 }
 
-void PotentialClashesList::AddPotentialClash(const EDiversionPotentialClashInfo& ClashInfo)
+FDiversionState::FDiversionState(FDiversionState&& Other) noexcept
+	: LocalFilename(MoveTemp(Other.LocalFilename))
+	, TimeStamp(Other.TimeStamp)
+	, LastAccessTime(Other.LastAccessTime)
+	, LocalRevNumber(Other.LocalRevNumber)
+	, WorkingCopyState(Other.WorkingCopyState)
+	, IsSyncing(Other.IsSyncing)
+	, PotentialClashesVersion(Other.PotentialClashesVersion)
+	, SideData(Other.SideData.exchange(nullptr, std::memory_order_acq_rel))
 {
-	FWriteScopeLock Lock(*PotentialClashesRWLock);
-	PotentialClashes.Add(ClashInfo);
+	CopyHash(Other);
 }
 
-int PotentialClashesList::GetPotentialClashesCount() const
+FDiversionState& FDiversionState::operator=(const FDiversionState& Other)
 {
-	FReadScopeLock Lock(*PotentialClashesRWLock);
-	return PotentialClashes.Num();
+	if (this != &Other)
+	{
+		LocalFilename = Other.LocalFilename;
+		TimeStamp = Other.TimeStamp;
+		LastAccessTime = Other.LastAccessTime;
+		LocalRevNumber = Other.LocalRevNumber;
+		WorkingCopyState = Other.WorkingCopyState;
+		IsSyncing = Other.IsSyncing;
+		PotentialClashesVersion = Other.PotentialClashesVersion;
+		delete SideData.exchange(CloneSideData(Other.GetSideData()), std::memory_order_acq_rel);
+		CopyHash(Other);
+	}
+	return *this;
 }
 
-TArray<EDiversionPotentialClashInfo> PotentialClashesList::GetPotentialClashes() const
+FDiversionState& FDiversionState::operator=(FDiversionState&& Other) noexcept
 {
-	FReadScopeLock Lock(*PotentialClashesRWLock);
-	return PotentialClashes;
+	if (this != &Other)
+	{
+		LocalFilename = MoveTemp(Other.LocalFilename);
+		TimeStamp = Other.TimeStamp;
+		LastAccessTime = Other.LastAccessTime;
+		LocalRevNumber = Other.LocalRevNumber;
+		WorkingCopyState = Other.WorkingCopyState;
+		IsSyncing = Other.IsSyncing;
+		PotentialClashesVersion = Other.PotentialClashesVersion;
+		delete SideData.exchange(Other.SideData.exchange(nullptr, std::memory_order_acq_rel), std::memory_order_acq_rel);
+		CopyHash(Other);
+	}
+	return *this;
 }
 
-FDiversionState::FDiversionState(const FDiversionState& Other) = default;
-FDiversionState::FDiversionState(FDiversionState&& Other) noexcept = default;
-FDiversionState& FDiversionState::operator=(const FDiversionState& Other) = default;
-FDiversionState& FDiversionState::operator=(FDiversionState&& Other) noexcept = default;
-PRAGMA_ENABLE_DEPRECATION_WARNINGS
+FDiversionStateSideData& FDiversionState::GetOrCreateSideData()
+{
+	FDiversionStateSideData* ExistingSideData = GetSideData();
+	if (ExistingSideData != nullptr)
+	{
+		return *ExistingSideData;
+	}
+
+	FDiversionStateSideData* NewSideData = new FDiversionStateSideData();
+	if (SideData.compare_exchange_strong(ExistingSideData, NewSideData, std::memory_order_acq_rel))
+	{
+		return *NewSideData;
+	}
+	// Lost the race against another writer, use its side data
+	delete NewSideData;
+	return *ExistingSideData;
+}
 
 int32 FDiversionState::GetHistorySize() const
 {
-	return History.Num();
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return 0;
+	}
+	FReadScopeLock Lock(StateSideData->Lock);
+	return StateSideData->History.Num();
 }
 
 TSharedPtr<class ISourceControlRevision, ESPMode::ThreadSafe> FDiversionState::GetHistoryItem(int32 HistoryIndex) const
 {
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (!DiversionUtils::DiversionValidityCheck(StateSideData != nullptr,
+		"HistoryIndex is out of range", FDiversionModule::Get().GetOriginalAccountID())) {
+		return nullptr;
+	}
+
+	FReadScopeLock Lock(StateSideData->Lock);
+	const TDiversionHistory& History = StateSideData->History;
 	if (!DiversionUtils::DiversionValidityCheck(History.IsValidIndex(HistoryIndex),
 		"HistoryIndex is out of range", FDiversionModule::Get().GetOriginalAccountID())) {
 		// TODO: Might lead to wrong history lists, might be better to return nullptr here or assert like before
@@ -71,7 +165,14 @@ TSharedPtr<class ISourceControlRevision, ESPMode::ThreadSafe> FDiversionState::G
 
 TSharedPtr<class ISourceControlRevision, ESPMode::ThreadSafe> FDiversionState::FindHistoryRevision(int32 RevisionNumber) const
 {
-	for (const auto& Revision : History)
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return nullptr;
+	}
+
+	FReadScopeLock Lock(StateSideData->Lock);
+	for (const auto& Revision : StateSideData->History)
 	{
 		if (Revision->GetRevisionNumber() == RevisionNumber)
 		{
@@ -84,7 +185,14 @@ TSharedPtr<class ISourceControlRevision, ESPMode::ThreadSafe> FDiversionState::F
 
 TSharedPtr<class ISourceControlRevision, ESPMode::ThreadSafe> FDiversionState::FindHistoryRevision(const FString& InRevision) const
 {
-	for (const auto& Revision : History)
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return nullptr;
+	}
+
+	FReadScopeLock Lock(StateSideData->Lock);
+	for (const auto& Revision : StateSideData->History)
 	{
 		if (Revision->GetRevision() == InRevision)
 		{
@@ -107,7 +215,7 @@ TSharedPtr<class ISourceControlRevision, ESPMode::ThreadSafe> FDiversionState::G
 
 ISourceControlState::FResolveInfo FDiversionState::GetResolveInfo() const
 {
-	return PendingResolveInfo;
+	return GetPendingResolveInfo();
 }
 
 FSlateIcon FDiversionState::GetIcon() const
@@ -118,7 +226,7 @@ FSlateIcon FDiversionState::GetIcon() const
 	}
 	if(IsConflicted())
 	{
-		if(PendingResolveInfo.ResolutionSide.IsSet())
+		if(GetPendingResolveInfo().ResolutionSide.IsSet())
 		{
 			return FSlateIcon(FRevisionControlStyleManager::GetStyleSetName(), "RevisionControl.ConflictResolution.Clear");	
 		}
@@ -194,6 +302,7 @@ FText FDiversionState::GetDisplayTooltip() const
 	}
 	if(IsConflicted())
 	{
+		const FDiversionResolveInfo PendingResolveInfo = GetPendingResolveInfo();
 		if(PendingResolveInfo.ResolutionSide.IsSet())
 		{
 			switch (PendingResolveInfo.ResolutionSide.GetValue())
@@ -273,7 +382,7 @@ bool FDiversionState::IsCheckedOutOther(FString* Who) const
 {
 	return
 		IsDiversionSoftLockEnabled() && // Disable this feature if the user wants to
-		(PotentialClashes.GetPotentialClashesCount() > 0) &&
+		(GetPotentialClashesCount() > 0) &&
 		!IsConflicted(); // If the file is already conflicted, we don't want to auto lock it
 }
 
@@ -348,7 +457,13 @@ bool FDiversionState::CanAdd() const
 
 bool FDiversionState::IsConflicted() const
 {
-	return PendingResolveInfo;
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return false;
+	}
+	FReadScopeLock Lock(StateSideData->Lock);
+	return StateSideData->PendingResolveInfo;
 }
 
 bool FDiversionState::CanRevert() const
@@ -366,7 +481,11 @@ bool FDiversionState::IsAutoSoftLocked() const
 void FDiversionState::ResetState()
 {
 	WorkingCopyState = EWorkingCopyState::Unchanged;
-	PotentialClashes.ResetPotentialClashes();
+	if (GetPotentialClashesCount() > 0)
+	{
+		BumpPotentialClashesVersion();
+	}
+	ResetPotentialClashes();
 	TimeStamp = FDateTime::MinValue();
 	IsSyncing = false;
 }
@@ -374,7 +493,7 @@ void FDiversionState::ResetState()
 FString FDiversionState::GetOtherEditorsList() const {
 	// Generate a local copy of the potential clashes array
 	// Used since this array might get changed in the background by the worker thread
-	TArray<EDiversionPotentialClashInfo> PotentialClashesCopy = PotentialClashes.GetPotentialClashes();
+	TArray<EDiversionPotentialClashInfo> PotentialClashesCopy = GetPotentialClashes();
 	
 	FString OtherEditors = "Potential Conflict!\nFile is also edited by:";
 	for (int i = 0; i < PotentialClashesCopy.Num(); i++) {
@@ -393,18 +512,201 @@ FString FDiversionState::GetOtherEditorsList() const {
 
 void FDiversionState::ClearResolveInfo()
 {
-	PendingResolveInfo.RemoteRevision.Empty();
-	PendingResolveInfo.RemoteFile.Empty();
+	FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return;
+	}
+	FWriteScopeLock Lock(StateSideData->Lock);
+	StateSideData->PendingResolveInfo.RemoteRevision.Empty();
+	StateSideData->PendingResolveInfo.RemoteFile.Empty();
 }
 
-const FDiversionResolveInfo& FDiversionState::GetPendingResolveInfo() const
+FDiversionResolveInfo FDiversionState::GetPendingResolveInfo() const
 {
-	return PendingResolveInfo;
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return FDiversionResolveInfo();
+	}
+	FReadScopeLock Lock(StateSideData->Lock);
+	return StateSideData->PendingResolveInfo;
 }
 
 void FDiversionState::AddPendingResolveInfo(const FDiversionResolveInfo& InResolveInfo)
 {
-	PendingResolveInfo = InResolveInfo;
+	FDiversionStateSideData& StateSideData = GetOrCreateSideData();
+	FWriteScopeLock Lock(StateSideData.Lock);
+	StateSideData.PendingResolveInfo = InResolveInfo;
+}
+
+TDiversionHistory FDiversionState::GetHistory() const
+{
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return TDiversionHistory();
+	}
+	FReadScopeLock Lock(StateSideData->Lock);
+	return StateSideData->History;
+}
+
+void FDiversionState::SetHistory(const TDiversionHistory& InHistory)
+{
+	if (InHistory.IsEmpty() && GetSideData() == nullptr)
+	{
+		return;
+	}
+	FDiversionStateSideData& StateSideData = GetOrCreateSideData();
+	FWriteScopeLock Lock(StateSideData.Lock);
+	StateSideData.History = InHistory;
+}
+
+void FDiversionState::SetPotentialClashes(const TArray<EDiversionPotentialClashInfo>& InPotentialClashes)
+{
+	if (InPotentialClashes.IsEmpty())
+	{
+		ResetPotentialClashes();
+		return;
+	}
+	FDiversionStateSideData& StateSideData = GetOrCreateSideData();
+	FWriteScopeLock Lock(StateSideData.Lock);
+	StateSideData.PotentialClashes = InPotentialClashes;
+}
+
+void FDiversionState::ResetPotentialClashes()
+{
+	FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return;
+	}
+	FWriteScopeLock Lock(StateSideData->Lock);
+	StateSideData->PotentialClashes.Empty();
+}
+
+int FDiversionState::GetPotentialClashesCount() const
+{
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return 0;
+	}
+	FReadScopeLock Lock(StateSideData->Lock);
+	return StateSideData->PotentialClashes.Num();
+}
+
+TArray<EDiversionPotentialClashInfo> FDiversionState::GetPotentialClashes() const
+{
+	const FDiversionStateSideData* StateSideData = GetSideData();
+	if (StateSideData == nullptr)
+	{
+		return TArray<EDiversionPotentialClashInfo>();
+	}
+	FReadScopeLock Lock(StateSideData->Lock);
+	return StateSideData->PotentialClashes;
+}
+
+FString FDiversionState::GetHash() const
+{
+	switch (HashKind.load(std::memory_order_acquire))
+	{
+	case EHashKind::Digest:
+		{
+			uint8 Digest[HashDigestSize];
+			LoadHashDigest(Digest);
+			return BytesToHexLower(Digest, HashDigestSize);
+		}
+	case EHashKind::Opaque:
+		if (const FDiversionStateSideData* StateSideData = GetSideData())
+		{
+			FReadScopeLock Lock(StateSideData->Lock);
+			return StateSideData->OpaqueHash;
+		}
+		break;
+	default:
+		break;
+	}
+	return FString();
+}
+
+void FDiversionState::SetHash(const FString& InHash)
+{
+	// Each representation is filled before HashKind publishes it, so readers never see a kind ahead of its data.
+	// A replaced opaque hash is left in the side data, a reader might still be about to read it.
+
+	// The backend hash is opaque, but in practice it's a SHA-1 digest - keep it inline when it is
+	if (IsLowerHexDigest(InHash, HashDigestSize))
+	{
+		uint8 Digest[HashDigestSize];
+		HexToBytes(InHash, Digest);
+		StoreHashDigest(Digest);
+		HashKind.store(EHashKind::Digest, std::memory_order_release);
+	}
+	else if (!InHash.IsEmpty())
+	{
+		FDiversionStateSideData& StateSideData = GetOrCreateSideData();
+		{
+			FWriteScopeLock Lock(StateSideData.Lock);
+			StateSideData.OpaqueHash = InHash;
+		}
+		HashKind.store(EHashKind::Opaque, std::memory_order_release);
+	}
+	else
+	{
+		HashKind.store(EHashKind::None, std::memory_order_release);
+	}
+}
+
+void FDiversionState::LoadHashDigest(uint8 (&OutDigest)[HashDigestSize]) const
+{
+	uint32 Words[HashDigestWordCount];
+	for (;;)
+	{
+		const uint32 Sequence = HashSequence.load(std::memory_order_acquire);
+		if ((Sequence & 1) == 0)
+		{
+			for (int32 WordIndex = 0; WordIndex < HashDigestWordCount; ++WordIndex)
+			{
+				Words[WordIndex] = HashDigestWords[WordIndex].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (HashSequence.load(std::memory_order_relaxed) == Sequence)
+			{
+				break;
+			}
+		}
+		FPlatformProcess::YieldThread();
+	}
+	FMemory::Memcpy(OutDigest, Words, HashDigestSize);
+}
+
+void FDiversionState::StoreHashDigest(const uint8 (&InDigest)[HashDigestSize])
+{
+	uint32 Words[HashDigestWordCount];
+	FMemory::Memcpy(Words, InDigest, HashDigestSize);
+
+	const uint32 Sequence = HashSequence.load(std::memory_order_relaxed);
+	HashSequence.store(Sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	for (int32 WordIndex = 0; WordIndex < HashDigestWordCount; ++WordIndex)
+	{
+		HashDigestWords[WordIndex].store(Words[WordIndex], std::memory_order_relaxed);
+	}
+	HashSequence.store(Sequence + 2, std::memory_order_release);
+}
+
+void FDiversionState::CopyHash(const FDiversionState& Other)
+{
+	// The side data (and its opaque hash) was copied by the caller
+	const EHashKind OtherHashKind = Other.HashKind.load(std::memory_order_acquire);
+	if (OtherHashKind == EHashKind::Digest)
+	{
+		uint8 Digest[HashDigestSize];
+		Other.LoadHashDigest(Digest);
+		StoreHashDigest(Digest);
+	}
+	HashKind.store(OtherHashKind, std::memory_order_release);
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -5,9 +5,11 @@
 #include "DiversionRevision.h"
 #include "Conflict.h"
 
+#include <atomic>
+
 namespace EWorkingCopyState
 {
-	enum Type
+	enum Type : uint8
 	{
 		Unknown,
 		Unchanged, // called "clean" in SVN, "Pristine" in Perforce
@@ -59,28 +61,34 @@ struct EDiversionPotentialClashInfo {
 	
 	/* Seconds since epoch UTC */
 	int64 Mtime;
+
+	bool operator==(const EDiversionPotentialClashInfo& Other) const
+	{
+		return CommitID == Other.CommitID && WorkspaceID == Other.WorkspaceID && BranchName == Other.BranchName &&
+			Email == Other.Email && FullName == Other.FullName && Mtime == Other.Mtime;
+	}
 };
 
-class PotentialClashesList
+/**
+ * Rarely populated parts of a state (history, pending resolve and potential clashes).
+ * Allocated on first use so the vast majority of cached states only pay for a pointer.
+ */
+struct FDiversionStateSideData
 {
-public:
-	PotentialClashesList():
-		PotentialClashes(TArray<EDiversionPotentialClashInfo>()),
-		PotentialClashesRWLock(MakeShared<FRWLock>()) {}
-	
-	void ResetPotentialClashes();
+	/** History of the item, if any */
+	TDiversionHistory History;
 
-	void SetPotentialClashes(const TArray<EDiversionPotentialClashInfo>& InPotentialClashes);
+	/** Pending rev info with which a file must be resolved, invalid if no resolve pending */
+	FDiversionResolveInfo PendingResolveInfo;
 
-	void AddPotentialClash(const EDiversionPotentialClashInfo& ClashInfo);
-	
-	int GetPotentialClashesCount() const;
+	/** Potential clashes with other editing users */
+	TArray<EDiversionPotentialClashInfo> PotentialClashes;
 
-	TArray<EDiversionPotentialClashInfo> GetPotentialClashes() const;
+	/** Backend hash of the entry, only used when it isn't a SHA-1 digest */
+	FString OpaqueHash;
 
-private:
-	TArray<EDiversionPotentialClashInfo> PotentialClashes;
-	mutable TSharedRef<FRWLock> PotentialClashesRWLock;
+	/** Guards the side data - potential clashes might be read while being updated in the background */
+	mutable FRWLock Lock;
 };
 
 class FDiversionState : public ISourceControlState
@@ -88,11 +96,12 @@ class FDiversionState : public ISourceControlState
 public:
 	FDiversionState(const FString& InLocalFilename)
 		: LocalFilename(InLocalFilename)
+		, TimeStamp(0)
 		, LocalRevNumber(INVALID_REVISION)
 		, WorkingCopyState(EWorkingCopyState::Unknown)
-		, TimeStamp(0)
 	{
 	}
+	virtual ~FDiversionState() override;
 
 	FDiversionState(const FDiversionState& Other);
 	FDiversionState(FDiversionState&& Other) noexcept;
@@ -144,39 +153,95 @@ public:
 	
 	void ClearResolveInfo();
 
-	const FDiversionResolveInfo& GetPendingResolveInfo() const;
+	FDiversionResolveInfo GetPendingResolveInfo() const;
 
 	void AddPendingResolveInfo(const FDiversionResolveInfo& InResolveInfo);
 
-public:
-	/** History of the item, if any */
-	TDiversionHistory History;
+	TDiversionHistory GetHistory() const;
 
-	/** Filename on disk */
-	FString LocalFilename;
+	void SetHistory(const TDiversionHistory& InHistory);
 
-	/** Latest rev number at which a file was synced to before being edited */
-	int LocalRevNumber;
+	/** Potential clashes with other editing users */
+	void SetPotentialClashes(const TArray<EDiversionPotentialClashInfo>& InPotentialClashes);
 
-	UE_DEPRECATED(5.3, "Use PendingResolveInfo.BaseRevision instead")
-	FString PendingMergeBaseFileHash;
+	void ResetPotentialClashes();
 
-	/** State of the working copy */
-	EWorkingCopyState::Type WorkingCopyState;
+	int GetPotentialClashesCount() const;
+
+	TArray<EDiversionPotentialClashInfo> GetPotentialClashes() const;
+
+	/** Bumped by the provider whenever the potential clashes change, lets the UI cache what it derives from them */
+	uint16 GetPotentialClashesVersion() const { return PotentialClashesVersion; }
+
+	void BumpPotentialClashesVersion() { ++PotentialClashesVersion; }
+
+	/** Hash of the entry, as reported by the backend. Safe to call while the game thread sets it */
+	FString GetHash() const;
+
+	/** Game thread only for cached states, there must be a single writer */
+	void SetHash(const FString& InHash);
+
+	bool HasHash() const { return HashKind.load(std::memory_order_acquire) != EHashKind::None; }
+
+public:
+	/** Filename on disk. Also the key of the cached state, it must not change once the state is cached */
+	FString LocalFilename;
 
 	/** The timestamp of the last update */
 	FDateTime TimeStamp;
 
-	/** Potential clashes with other editing users */
-	PotentialClashesList PotentialClashes;
+	/** Last time (FPlatformTime::Seconds) the provider handed out this state, used for state cache eviction */
+	double LastAccessTime = 0.0;
 
-	/** Hash of the entry */
-	FString Hash;
+	/** Latest rev number at which a file was synced to before being edited */
+	int LocalRevNumber;
+
+	/** State of the working copy */
+	EWorkingCopyState::Type WorkingCopyState;
 
 	/** Flag to indicate if the file is currently being synced or is it's working state valid */
 	bool IsSyncing = false;
 
 private:
-	/** Pending rev info with which a file must be resolved, invalid if no resolve pending */
-	FDiversionResolveInfo PendingResolveInfo;
+	/** Returns the side data, allocating it on first use */
+	FDiversionStateSideData& GetOrCreateSideData();
+
+	/** Side data if it was ever needed by this state, null otherwise */
+	FDiversionStateSideData* GetSideData() const { return SideData.load(std::memory_order_acquire); }
+
+	static constexpr int32 HashDigestSize = 20;
+	static constexpr int32 HashDigestWordCount = HashDigestSize / sizeof(uint32);
+
+	/** Reads a consistent copy of the digest, retrying while SetHash rewrites it */
+	void LoadHashDigest(uint8 (&OutDigest)[HashDigestSize]) const;
+
+	/** Writes the digest, readers see either the previous or the new one */
+	void StoreHashDigest(const uint8 (&InDigest)[HashDigestSize]);
+
+	/** Copies the hash of another state, used by the copy and move operations */
+	void CopyHash(const FDiversionState& Other);
+
+	enum class EHashKind : uint8
+	{
+		None,
+		/** Stored inline in HashDigestWords */
+		Digest,
+		/** Stored in the side data */
+		Opaque,
+	};
+
+	/** Which representation holds the hash. Published after the representation is filled */
+	std::atomic<EHashKind> HashKind = EHashKind::None;
+
+	/** Fits in the padding before HashSequence, wrapping around is harmless since it's only compared for equality */
+	uint16 PotentialClashesVersion = 0;
+
+	/** Odd while the digest is being rewritten, see LoadHashDigest */
+	std::atomic<uint32> HashSequence = 0;
+
+	/** SHA-1 digest of the entry, valid if HashKind is Digest. Words so concurrent reads are well defined */
+	std::atomic<uint32> HashDigestWords[HashDigestWordCount] = {};
+
+	/** Lazily allocated rarely populated data, see FDiversionStateSideData */
+	std::atomic<FDiversionStateSideData*> SideData = nullptr;
 };
@@ -0,0 +1,267 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "DiversionStateCacheFile.h"
+
+#include "ISourceControlModule.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 StateCacheFileMagic = 0x44565343; // "DVSC"
+	// Bump when the layout below changes, older files are then discarded
+	constexpr uint32 StateCacheFileVersion = 1;
+
+	enum class ELoadResult
+	{
+		Loaded,
+		Invalid
+	};
+
+	void SerializeResolveInfo(FArchive& Ar, FDiversionResolveInfo& ResolveInfo)
+	{
+		Ar << ResolveInfo.BaseFile;
+		Ar << ResolveInfo.BaseRevision;
+		Ar << ResolveInfo.RemoteFile;
+		Ar << ResolveInfo.RemoteRevision;
+		Ar << ResolveInfo.MergeId;
+		Ar << ResolveInfo.ConflictId;
+
+		int32 ResolutionSide = ResolveInfo.ResolutionSide.IsSet() ? static_cast<int32>(ResolveInfo.ResolutionSide.GetValue()) : INDEX_NONE;
+		Ar << ResolutionSide;
+		if (Ar.IsLoading())
+		{
+			ResolveInfo.ResolutionSide.Reset();
+			using EResolvedSide = Diversion::CoreAPI::Model::Conflict::Resolved_sideEnum;
+			if (ResolutionSide < INDEX_NONE || ResolutionSide > static_cast<int32>(EResolvedSide::OTHER))
+			{
+				// Not a value this version writes, the file is corrupted
+				Ar.SetError();
+			}
+			else if (ResolutionSide != INDEX_NONE)
+			{
+				ResolveInfo.ResolutionSide = static_cast<EResolvedSide>(ResolutionSide);
+			}
+		}
+	}
+
+	void WriteStates(FArchive& Ar, const WorkspaceInfo& InWsInfo, const FDiversionPersistedStates& InStates)
+	{
+		uint32 Magic = StateCacheFileMagic;
+		uint32 Version = StateCacheFileVersion;
+		FString WorkspaceID = InWsInfo.WorkspaceID;
+		FString CommitID = InWsInfo.CommitID;
+		FString WorkspacePath = InWsInfo.GetPath();
+		Ar << Magic << Version << WorkspaceID << CommitID << WorkspacePath;
+
+		int32 NumStates = InStates.States.Num();
+		Ar << NumStates;
+		for (const auto& [Path, State] : InStates.States)
+		{
+			FString FilePath = Path;
+			uint8 WorkingCopyState = static_cast<uint8>(State.WorkingCopyState);
+			FDateTime TimeStamp = State.TimeStamp;
+			int32 LocalRevNumber = State.LocalRevNumber;
+			FString Hash = State.GetHash();
+			Ar << FilePath << WorkingCopyState << TimeStamp << LocalRevNumber << Hash;
+		}
+
+		int32 NumClashedFiles = InStates.PotentialClashes.Num();
+		Ar << NumClashedFiles;
+		for (const auto& [Path, Clashes] : InStates.PotentialClashes)
+		{
+			FString FilePath = Path;
+			int32 NumClashes = Clashes.Num();
+			Ar << FilePath << NumClashes;
+			for (EDiversionPotentialClashInfo Clash : Clashes)
+			{
+				Ar << Clash.CommitID << Clash.WorkspaceID << Clash.BranchName << Clash.Email << Clash.FullName << Clash.Mtime;
+			}
+		}
+
+		int32 NumConflictedFiles = InStates.ConflictedFiles.Num();
+		Ar << NumConflictedFiles;
+		for (const auto& [Path, ResolveInfo] : InStates.ConflictedFiles)
+		{
+			FString FilePath = Path;
+			FDiversionResolveInfo ResolveInfoCopy = ResolveInfo;
+			Ar << FilePath;
+			SerializeResolveInfo(Ar, ResolveInfoCopy);
+		}
+	}
+
+	ELoadResult ReadStates(FArchive& Ar, const WorkspaceInfo& InWsInfo, FDiversionPersistedStates& OutStates)
+	{
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		Ar << Magic << Version;
+		if (Ar.IsError() || Magic != StateCacheFileMagic || Version != StateCacheFileVersion)
+		{
+			return ELoadResult::Invalid;
+		}
+
+		FString WorkspaceID;
+		FString CommitID;
+		FString WorkspacePath;
+		Ar << WorkspaceID << CommitID << WorkspacePath;
+		if (Ar.IsError() || WorkspaceID != InWsInfo.WorkspaceID || CommitID != InWsInfo.CommitID || WorkspacePath != InWsInfo.GetPath())
+		{
+			return ELoadResult::Invalid;
+		}
+
+		int32 NumStates = 0;
+		Ar << NumStates;
+		for (int32 Index = 0; Index < NumStates && !Ar.IsError(); ++Index)
+		{
+			FString FilePath;
+			uint8 WorkingCopyState = EWorkingCopyState::Unknown;
+			FDateTime TimeStamp;
+			int32 LocalRevNumber = INVALID_REVISION;
+			FString Hash;
+			Ar << FilePath << WorkingCopyState << TimeStamp << LocalRevNumber << Hash;
+			if (WorkingCopyState > EWorkingCopyState::Ignored)
+			{
+				// Not a value this version writes, the file is corrupted
+				Ar.SetError();
+				break;
+			}
+
+			FDiversionState State(FilePath);
+			State.WorkingCopyState = static_cast<EWorkingCopyState::Type>(WorkingCopyState);
+			State.TimeStamp = TimeStamp;
+			State.LocalRevNumber = LocalRevNumber;
+			State.SetHash(Hash);
+			OutStates.States.Add(FilePath, MoveTemp(State));
+		}
+
+		int32 NumClashedFiles = 0;
+		Ar << NumClashedFiles;
+		for (int32 Index = 0; Index < NumClashedFiles && !Ar.IsError(); ++Index)
+		{
+			FString FilePath;
+			int32 NumClashes = 0;
+			Ar << FilePath << NumClashes;
+			TArray<EDiversionPotentialClashInfo>& Clashes = OutStates.PotentialClashes.Add(FilePath);
+			for (int32 ClashIndex = 0; ClashIndex < NumClashes && !Ar.IsError(); ++ClashIndex)
+			{
+				EDiversionPotentialClashInfo Clash(TEXT(""), TEXT(""), TEXT(""), TEXT(""), TEXT(""), 0);
+				Ar << Clash.CommitID << Clash.WorkspaceID << Clash.BranchName << Clash.Email << Clash.FullName << Clash.Mtime;
+				Clashes.Add(MoveTemp(Clash));
+			}
+		}
+
+		int32 NumConflictedFiles = 0;
+		Ar << NumConflictedFiles;
+		for (int32 Index = 0; Index < NumConflictedFiles && !Ar.IsError(); ++Index)
+		{
+			FString FilePath;
+			FDiversionResolveInfo ResolveInfo;
+			Ar << FilePath;
+			SerializeResolveInfo(Ar, ResolveInfo);
+			OutStates.ConflictedFiles.Add(FilePath, MoveTemp(ResolveInfo));
+		}
+
+		return Ar.IsError() ? ELoadResult::Invalid : ELoadResult::Loaded;
+	}
+
+	ELoadResult ReadStatesFromMemory(TArrayView<const uint8> InBytes, const WorkspaceInfo& InWsInfo, FDiversionPersistedStates& OutStates)
+	{
+		FMemoryReaderView Reader(InBytes);
+		// Guard the reads against corrupted counts/string lengths
+		Reader.ArMaxSerializeSize = InBytes.Num();
+		return ReadStates(Reader, InWsInfo, OutStates);
+	}
+}
+
+FString DiversionStateCacheFile::GetStateCacheFilePath(const FString& WorkspaceID)
+{
+	return FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("Diversion") / FString::Printf(TEXT("StateCache-%s.bin"), *WorkspaceID));
+}
+
+bool DiversionStateCacheFile::Save(const WorkspaceInfo& InWsInfo, const FDiversionPersistedStates& InStates)
+{
+	if (!InWsInfo.IsValid())
+	{
+		return false;
+	}
+
+	const FString FilePath = GetStateCacheFilePath(InWsInfo.WorkspaceID);
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (InStates.IsEmpty())
+	{
+		PlatformFile.DeleteFile(*FilePath);
+		return false;
+	}
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	WriteStates(Writer, InWsInfo, InStates);
+
+	// Write to a temp file first so a crash mid-write never leaves a truncated cache behind
+	const FString TempFilePath = FilePath + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempFilePath))
+	{
+		UE_LOG(LogSourceControl, Warning, TEXT("Failed writing the Diversion state cache to %s"), *TempFilePath);
+		return false;
+	}
+	PlatformFile.DeleteFile(*FilePath);
+	if (!PlatformFile.MoveFile(*FilePath, *TempFilePath))
+	{
+		UE_LOG(LogSourceControl, Warning, TEXT("Failed moving the Diversion state cache to %s"), *FilePath);
+		PlatformFile.DeleteFile(*TempFilePath);
+		return false;
+	}
+
+	UE_LOG(LogSourceControl, Verbose, TEXT("Saved %d states to the Diversion state cache %s"), InStates.States.Num(), *FilePath);
+	return true;
+}
+
+bool DiversionStateCacheFile::Load(const WorkspaceInfo& InWsInfo, FDiversionPersistedStates& OutStates)
+{
+	if (!InWsInfo.IsValid())
+	{
+		return false;
+	}
+
+	const FString FilePath = GetStateCacheFilePath(InWsInfo.WorkspaceID);
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.FileExists(*FilePath))
+	{
+		return false;
+	}
+
+	ELoadResult Result = ELoadResult::Invalid;
+	{
+		TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*FilePath));
+		TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile.IsValid() ? MappedFile->MapRegion(0, MappedFile->GetFileSize()) : nullptr);
+		if (MappedRegion.IsValid())
+		{
+			Result = ReadStatesFromMemory(TArrayView<const uint8>(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize()), InWsInfo, OutStates);
+		}
+		else
+		{
+			// Memory mapping isn't supported everywhere, fall back to reading the file
+			TArray<uint8> Bytes;
+			if (FFileHelper::LoadFileToArray(Bytes, *FilePath))
+			{
+				Result = ReadStatesFromMemory(Bytes, InWsInfo, OutStates);
+			}
+		}
+		// The mapping is released here, before the file might get deleted below
+	}
+
+	if (Result != ELoadResult::Loaded)
+	{
+		UE_LOG(LogSourceControl, Log, TEXT("Discarding outdated or corrupted Diversion state cache %s"), *FilePath);
+		OutStates = FDiversionPersistedStates();
+		PlatformFile.DeleteFile(*FilePath);
+		return false;
+	}
+
+	UE_LOG(LogSourceControl, Log, TEXT("Loaded %d states from the Diversion state cache"), OutStates.States.Num());
+	return true;
+}
@@ -0,0 +1,43 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DiversionState.h"
+#include "DiversionWorkspaceInfo.h"
+
+/**
+ * Provider states persisted between editor sessions, so the content browser shows
+ * the right icons before the first full status update completes.
+ */
+struct FDiversionPersistedStates
+{
+	TMap<FString, FDiversionState> States;
+	TMap<FString, TArray<EDiversionPotentialClashInfo>> PotentialClashes;
+	TMap<FString, FDiversionResolveInfo> ConflictedFiles;
+
+	bool IsEmpty() const
+	{
+		return States.IsEmpty() && PotentialClashes.IsEmpty() && ConflictedFiles.IsEmpty();
+	}
+};
+
+namespace DiversionStateCacheFile
+{
+	/** Location of the state cache file of the given workspace, under the project Saved directory */
+	FString GetStateCacheFilePath(const FString& WorkspaceID);
+
+	/**
+	 * Writes the states to the workspace cache file (write to a temp file, then rename).
+	 * @returns true if the file was written
+	 */
+	bool Save(const WorkspaceInfo& InWsInfo, const FDiversionPersistedStates& InStates);
+
+	/**
+	 * Loads the workspace cache file. The file is memory mapped when the platform supports it.
+	 * A file written by another format version, for another workspace path or for another commit
+	 * is deleted and ignored - its states can't be trusted anymore.
+	 * @returns true if states were loaded
+	 */
+	bool Load(const WorkspaceInfo& InWsInfo, FDiversionPersistedStates& OutStates);
+}
@@ -1,6 +1,7 @@
 // Copyright 2024 Diversion Company, Inc. All Rights Reserved.
 
 #include "DiversionTimedDelegate.h"
+#include "DiversionConstants.h"
 
 void FTimedDelegateWrapper::TriggerInstantCallAndReset()
 {
@@ -56,12 +57,32 @@ void FTimedDelegateWrapper::Stop()
 
 bool FTimedDelegateWrapper::OnEditorTick(float DeltaTime)
 {
+	if (ShouldSuspend())
+	{
+		// Keep counting, so the resume below knows whether a call came due meanwhile
+		ElapsedTime += DeltaTime;
+		bSuspended = true;
+		return true;
+	}
+
+	if (bSuspended)
+	{
+		bSuspended = false;
+		if (ElapsedTime >= NextCallDelay)
+		{
+			// A call came due while suspended - run it soon, without all the editors of a team waking up at once
+			ElapsedTime = 0.0f;
+			NextCallDelay = FMath::FRandRange(0.0f, SECONDS_MAX_POLL_RESUME_DELAY);
+			return true;
+		}
+	}
+
 	ElapsedTime += DeltaTime;
-	if (ElapsedTime >= Interval)
+	if (ElapsedTime >= NextCallDelay)
 	{
 		// Trigger the function and reset the timer
 		Delegate.ExecuteIfBound();
-		ElapsedTime = 0.0f;
+		ResetInterval();
 	}
 	return true;
 }
@@ -69,4 +90,46 @@ bool FTimedDelegateWrapper::OnEditorTick(float DeltaTime)
 void FTimedDelegateWrapper::ResetInterval()
 {
 	ElapsedTime = 0.0f;
+	ScheduleNextCall();
+}
+
+void FTimedDelegateWrapper::ReportPollResult(bool bChanged)
+{
+	if (bChanged)
+	{
+		ResetBackoff();
+		return;
+	}
+
+	const float MaxInterval = BaseInterval * POLL_MAX_BACKOFF_FACTOR;
+	if (Interval < MaxInterval)
+	{
+		Interval = FMath::Min(Interval * 2.0f, MaxInterval);
+		ScheduleNextCall();
+	}
+}
+
+void FTimedDelegateWrapper::ResetBackoff()
+{
+	if (Interval > BaseInterval)
+	{
+		Interval = BaseInterval;
+		// The remaining wait shrinks with the interval
+		ScheduleNextCall();
+	}
+}
+
+void FTimedDelegateWrapper::ScheduleNextCall()
+{
+	NextCallDelay = Interval * FMath::FRandRange(1.0f - POLL_INTERVAL_JITTER, 1.0f + POLL_INTERVAL_JITTER);
+}
+
+bool FTimedDelegateWrapper::ShouldSuspend()
+{
+	if (FApp::IsUnattended())
+	{
+		// Commandlets and render queues never have the focus
+		return false;
+	}
+	return !FApp::HasFocus() || (GEditor != nullptr && GEditor->PlayWorld != nullptr);
 }
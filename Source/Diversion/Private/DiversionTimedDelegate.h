@@ -7,12 +7,21 @@
 
 DECLARE_DELEGATE(DiversionTimerDelegate);
 
+/**
+ * Calls a delegate periodically on the game thread, adapting the interval to the activity:
+ * - The interval doubles after every poll reported unchanged (up to POLL_MAX_BACKOFF_FACTOR times the base interval)
+ *   and drops back to the base interval on a change or local activity.
+ * - Polling is suspended while the editor is unfocused or playing in editor, the poll that came due meanwhile
+ *   runs shortly after resuming.
+ * - Every interval is jittered so editors don't poll in lockstep.
+ */
 class FTimedDelegateWrapper
 {
 public:
 	FTimedDelegateWrapper(const DiversionTimerDelegate& InDelegate, float InInterval)
-		: Delegate(InDelegate), Interval(InInterval), bTimerActive(false)
+		: Delegate(InDelegate), BaseInterval(InInterval), Interval(InInterval), bTimerActive(false)
 	{
+		ScheduleNextCall();
 	}
 
 	~FTimedDelegateWrapper()
@@ -32,10 +41,28 @@ public:
 
 	void ResetInterval();
 
+	/** Backs the interval off if the last poll found nothing new, or goes back to the base interval otherwise */
+	void ReportPollResult(bool bChanged);
+
+	/** Goes back to the base interval, e.g. after a local change that the next poll should pick up promptly */
+	void ResetBackoff();
+
+	float GetCurrentInterval() const { return Interval; }
+
+private:
+	/** Draws the jittered delay of the next call from the current interval */
+	void ScheduleNextCall();
+
+	/** Unfocused editor or PIE session - nobody looks at the results */
+	static bool ShouldSuspend();
+
 private:
 	DiversionTimerDelegate Delegate;
+	const float BaseInterval;
 	float Interval;
+	float NextCallDelay = 0.0f;
 	float ElapsedTime = 0.0f;
 	bool bTimerActive;
+	bool bSuspended = false;
 	FTSTicker::FDelegateHandle TickHandle;
 };
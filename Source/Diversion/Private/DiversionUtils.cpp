@@ -2,6 +2,7 @@
 
 #include "DiversionUtils.h"
 #include "DiversionCommand.h"
+#include "DiversionStatCache.h"
 #include "DiversionState.h"
 #include "DiversionSettings.h"
 #include "HAL/PlatformProcess.h"
@@ -515,11 +516,11 @@ FString GetFilePathFromAssetData(const FAssetData& AssetData)
 	return AssetPath;
 }
 
-TSet<FString> GetPathsCommonPrefixes(const TArray<FString>& InPaths, const FString& InBaseRepoPath, int32 InLimit)
+TSet<FString> GetPathsCommonPrefixes(const TArray<FString>& InPaths, const FString& InBaseRepoPath, FDiversionStatCache& InStatCache, int32 InLimit)
 {
 	TSet<FString> PathPrefixes;
 	for (auto& FileOrDir : InPaths) {
-		bool IsPathADirectory = FPaths::DirectoryExists(FileOrDir);
+		bool IsPathADirectory = InStatCache.IsDirectory(FileOrDir);
 		FString PathAsDirectory = IsPathADirectory ? FileOrDir : FPaths::GetPath(FileOrDir);
 
 		PathPrefixes.Add(PathAsDirectory);
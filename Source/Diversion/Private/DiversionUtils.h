@@ -13,6 +13,9 @@
 #include "DiversionState.h"
 #include "CoreAPI/Public/Merge.h"
 
+class FDiversionStatCache;
+class FThreadSafeBool;
+
 
 
 const FString DIVERSION_API_HOST = TEXT("api.diversion.dev");
@@ -133,10 +136,11 @@ FString GetFilePathFromAssetData(const FAssetData& AssetData);
  * Inclusive for folders path as well.
  * @param InPaths The paths to extract common prefixes from. Pass 0 for no limit.
  * @param InBaseRepoPath The base path to extract the common prefixes from.
+ * @param InStatCache Tells which paths are directories.
  * @param InLimit The maximum number of prefixes to return.
  * @returns Set containing the common prefixes as relative paths to the repo root provided.
  */
-TSet<FString> GetPathsCommonPrefixes(const TArray<FString>& InPaths, const FString& InBaseRepoPath, int32 InLimit = 0);
+TSet<FString> GetPathsCommonPrefixes(const TArray<FString>& InPaths, const FString& InBaseRepoPath, FDiversionStatCache& InStatCache, int32 InLimit = 0);
 
 FString FindCommonAncestorDirectory(const TArray<FString>& InPaths);
 
@@ -162,21 +166,51 @@ bool GetConflictedFiles(const FDiversionCommand& InCommand, TArray<FString>& Out
 	TArray<Diversion::CoreAPI::Model::Merge>& OutWorkspaceMergesList, TArray<Diversion::CoreAPI::Model::Merge>& OutBranchMergesList);
 bool RunGetMerges(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages,
 	TArray<FString>& OutErrorMessages, TArray<Diversion::CoreAPI::Model::Merge>& OutMerges);
-bool RunUpdateStatus(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, bool WaitForSync = true);
+/**
+ * Fetches the status of the command files into the status worker states.
+ * @param bSkipUnchanged leave the states empty if the status matches the one the states cache was last updated with,
+ *                       see IDiversionStatusWorker::bStatusUnchanged
+ */
+bool RunUpdateStatus(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages,
+	bool WaitForSync = true, bool bSkipUnchanged = false);
 bool RunCommit(FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, const FString& InDescription, bool WaitForSync = true);
 bool RunReset(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages);
 bool WaitForAgentSync(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, float InSecondsToTimeout = 10.f);
+/**
+ * Fetches the history of a file, newest revision first. Safe to run concurrently for several files of a command.
+ * @param OutFilePath the latest path of the file, empty if it has no history
+ */
 bool RunGetHistory(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, const FString& InFile, 
-	const FString* MergeFromRef);
+	const FString* MergeFromRef, FString& OutFilePath, TDiversionHistory& OutHistory);
 bool GetWsBlobInfo(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, const FString& InFile);
 bool RunResolvePath(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, 
 	const FString& InMergeId, const FString& InConflictId, bool WaitForSync = true);
 bool RunFinalizeMerge(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, const FString& InMergeId);
 // Exceptions to the API calls due to being executed irregularily by the engine
 bool DownloadFileFromURL(const FString& Url, const FString& SavePath);
-bool DownloadBlob(TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, const FString& InRefId, const FString& InOutputFilePath, const FString& InFilePath, WorkspaceInfo InWsInfo);
+/**
+ * Downloads a file at a ref. The content is streamed to a temp file next to InOutputFilePath,
+ * which is only renamed into place once complete and its size checked.
+ * @param InExpectedSha / InExpectedSize the blob of the file at the ref, its size is checked when set (see CheckBlobFileSize)
+ */
+bool DownloadBlob(TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, const FString& InRefId, const FString& InOutputFilePath, const FString& InFilePath, WorkspaceInfo InWsInfo,
+	const FString& InExpectedSha = FString(), int64 InExpectedSize = -1);
+/**
+ * Checks a downloaded blob has its expected size, which catches truncated downloads. Its content isn't checked
+ * against the server sha, how the server derives it isn't documented.
+ * @param InSha only names the blob in the logs
+ * @param InSize expected size, negative if unknown
+ */
+bool CheckBlobFileSize(const FString& InFile, const FString& InSha, int64 InSize);
 bool RunRepoInit(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, const FString& InRepoRootPath, const FString& InRepoName);
-bool GetPotentialFileClashes(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages, TMap<FString, TArray<EDiversionPotentialClashInfo>>& OutPotentialClashes, bool& OutRecurseCall);
+/**
+ * Fetches the potential clashes of the command files, in batches of path prefixes.
+ * @param InMaxParallelRequests number of batches requested concurrently
+ * @param InCancelled once set, the batches not sent yet are dropped and the call fails
+ */
+bool GetPotentialFileClashes(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages,
+	TMap<FString, TArray<EDiversionPotentialClashInfo>>& OutPotentialClashes, bool& OutRecurseCall,
+	int32 InMaxParallelRequests = 1, const FThreadSafeBool* InCancelled = nullptr);
 bool GetWorkspaceSyncProgress(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages);
 bool NotifyAgentSyncRequired(const FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages);
 bool UpdateWorkspace(FDiversionCommand& InCommand, TArray<FString>& OutInfoMessages, TArray<FString>& OutErrorMessages);
@@ -14,7 +14,7 @@ class IDiversionStatusWorker : public IDiversionWorker
 {
 public:
 	/** flag to indicate if the workspace contains conflicts and needs to be manually updated */
-	bool WorkspaceUpdateRequired;
+	bool WorkspaceUpdateRequired = false;
 
 	/** Temporary states for results */
 	TMap<FString, FDiversionState> States;
@@ -30,4 +30,10 @@ public:
 
 	/** Indicates that the request we sent to the BE is recursive */
 	bool bRecursiveRequest = true;
+
+	/** Fingerprint of the status pages and of everything else the parsed states depend on */
+	uint32 StatusFingerprint = 0;
+
+	/** The status matched the one the states cache was last updated with - States were left empty */
+	bool bStatusUnchanged = false;
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "Templates/SharedPointer.h"
 #include "DiversionUtils.h"
+#include "DiversionCommandScheduler.h"
 
 class IDiversionWorker
 {
@@ -25,6 +26,12 @@ public:
 	 */
 	virtual bool UpdateStates() const;
 
+	/**
+	 * Priority lane to run an asynchronous command of this worker on. Synchronous commands always run
+	 * on the interactive lane, since the game thread waits for them.
+	 */
+	virtual EDiversionCommandLane::Type GetLane(const class FDiversionCommand& InCommand) const { return EDiversionCommandLane::Interactive; }
+
 public:
 	/** Storing the state of agent sync 
 	* Relevant for most operations, since we need the FS state to be stable 
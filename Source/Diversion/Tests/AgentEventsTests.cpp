@@ -0,0 +1,297 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "HttpServerModule.h"
+#include "HttpServerResponse.h"
+#include "IHttpRouter.h"
+#include "DefaultApi.h"
+#include "DiversionAgentEvents.h"
+#include "DiversionHttpManager.h"
+
+namespace
+{
+	constexpr uint32 StandInAgentPort = 8798;
+	constexpr double SecondsToWaitForEvents = 10.0;
+	const FString WorkspacePath = TEXT("/Workspace");
+
+	/** Answers the agent events endpoint as the test dictates and counts any other request reaching it */
+	struct FStandInAgent
+	{
+		TSharedPtr<IHttpRouter> Router;
+		TArray<FHttpRouteHandle> Routes;
+		int32 NumEventRequests = 0;
+		int32 NumOtherRequests = 0;
+		/** The events request the agent holds open, like a real long poll */
+		FHttpResultCallback HeldEventsRequest;
+		bool bRespondImmediately = false;
+
+		bool Start()
+		{
+			Router = FHttpServerModule::Get().GetHttpRouter(StandInAgentPort);
+			if (!Router.IsValid())
+			{
+				return false;
+			}
+
+			Routes.Add(Router->BindRoute(FHttpPath(TEXT("/repo")), EHttpServerRequestVerbs::VERB_GET,
+				MakeHandler([this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete) {
+					++NumEventRequests;
+					if (bRespondImmediately)
+					{
+						OnComplete(MakeEventsResponse(TEXT("[]")));
+					}
+					else
+					{
+						HeldEventsRequest = OnComplete;
+					}
+					return true;
+				})));
+			for (const TCHAR* OtherPath : { TEXT("/health"), TEXT("/workspace"), TEXT("/workspaces") })
+			{
+				Routes.Add(Router->BindRoute(FHttpPath(OtherPath), EHttpServerRequestVerbs::VERB_GET | EHttpServerRequestVerbs::VERB_POST,
+					MakeHandler([this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete) {
+						++NumOtherRequests;
+						OnComplete(FHttpServerResponse::Error(EHttpServerResponseCodes::NotFound));
+						return true;
+					})));
+			}
+			FHttpServerModule::Get().StartAllListeners();
+			return true;
+		}
+
+		void Stop()
+		{
+			for (const FHttpRouteHandle& Route : Routes)
+			{
+				Router->UnbindRoute(Route);
+			}
+			Routes.Empty();
+		}
+
+		void RespondToHeldEvents(const FString& InEvents)
+		{
+			if (HeldEventsRequest)
+			{
+				FHttpResultCallback OnComplete = MoveTemp(HeldEventsRequest);
+				HeldEventsRequest = nullptr;
+				OnComplete(MakeEventsResponse(InEvents));
+			}
+		}
+
+	private:
+		static TUniquePtr<FHttpServerResponse> MakeEventsResponse(const FString& InEvents)
+		{
+			return FHttpServerResponse::Create(FString::Printf(TEXT("{\"Cursor\": 1, \"Events\": %s}"), *InEvents), TEXT("application/json"));
+		}
+
+		template <typename FunctorType>
+		static FHttpRequestHandler MakeHandler(FunctorType&& Functor)
+		{
+#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION <= 3
+			return FHttpRequestHandler(Forward<FunctorType>(Functor));
+#else
+			return FHttpRequestHandler::CreateLambda(Forward<FunctorType>(Functor));
+#endif
+		}
+	};
+
+	/** Latent condition, fails the test once it didn't hold in time */
+	TFunction<bool()> WaitFor(FAutomationTestBase* Test, const FString& What, TFunction<bool()> Condition)
+	{
+		return [Test, What, Condition, StartTime = 0.0]() mutable {
+			if (StartTime == 0.0)
+			{
+				StartTime = FPlatformTime::Seconds();
+			}
+			if (Condition())
+			{
+				return true;
+			}
+			if (FPlatformTime::Seconds() - StartTime > SecondsToWaitForEvents)
+			{
+				Test->AddError(FString::Printf(TEXT("Timed out waiting for %s"), *What));
+				return true;
+			}
+			return false;
+		};
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAgentEventsTestIdleWorkspace, "Diversion.Tests.AgentEvents.IdleWorkspace",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FAgentEventsTestIdleWorkspace::RunTest(const FString& Parameters)
+{
+	TSharedRef<FStandInAgent> Agent = MakeShared<FStandInAgent>();
+	if (!TestTrue(TEXT("Stand-in agent should start"), Agent->Start()))
+	{
+		return false;
+	}
+
+	auto ApiClient = MakeShared<DiversionHttp::FHttpRequestManager>(TEXT("127.0.0.1"), FString::FromInt(StandInAgentPort),
+		TMap<FString, FString>(), false);
+	TSharedRef<FDiversionAgentEventSubscription> Subscription = MakeShared<FDiversionAgentEventSubscription>(
+		MakeShared<Diversion::AgentAPI::DefaultApi>(ApiClient), TEXT("dv.repo.test"), TEXT("dv.ws.test"), WorkspacePath);
+	TSharedRef<TArray<FDiversionAgentEvent>> Received = MakeShared<TArray<FDiversionAgentEvent>>();
+	Subscription->Start();
+
+	// An idle workspace costs a single open request and nothing else reaches the agent
+	ADD_LATENT_AUTOMATION_COMMAND(FDelayedFunctionLatentCommand([this, Agent, Subscription, Received]() {
+		Subscription->ConsumeEvents(*Received);
+		TestEqual(TEXT("Events requests while idle"), Agent->NumEventRequests, 1);
+		TestEqual(TEXT("Other agent requests while idle"), Agent->NumOtherRequests, 0);
+		TestTrue(TEXT("No events while idle"), Received->IsEmpty());
+	}, 3.f));
+
+	// A change is delivered as soon as the agent answers
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([Agent]() {
+		Agent->RespondToHeldEvents(TEXT("[{\"Type\": \"FILES_CHANGED\", \"Paths\": [\"Content/Test.uasset\"]}]"));
+		return true;
+	}));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand(WaitFor(this, TEXT("the files changed event"), [Subscription, Received]() {
+		Subscription->ConsumeEvents(*Received);
+		return Received->ContainsByPredicate([](const FDiversionAgentEvent& Event) {
+			return Event.Type == FDiversionAgentEvent::EType::FilesChanged;
+		});
+	})));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Subscription, Received]() {
+		const FDiversionAgentEvent* FilesChanged = Received->FindByPredicate([](const FDiversionAgentEvent& Event) {
+			return Event.Type == FDiversionAgentEvent::EType::FilesChanged;
+		});
+		if (FilesChanged != nullptr && TestEqual(TEXT("Number of changed paths"), FilesChanged->Paths.Num(), 1))
+		{
+			TestEqual(TEXT("Changed path should be absolute"), FilesChanged->Paths[0], WorkspacePath / TEXT("Content/Test.uasset"));
+		}
+		TestTrue(TEXT("Subscription should be connected"), Subscription->IsConnected());
+		return true;
+	}));
+
+	// Shut down
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([Agent, Subscription]() {
+		Subscription->RequestStop();
+		Agent->bRespondImmediately = true;
+		Agent->RespondToHeldEvents(TEXT("[]"));
+		return true;
+	}));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand(WaitFor(this, TEXT("the subscription to stop"), [Subscription]() {
+		return !Subscription->IsRunning();
+	})));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([Agent]() {
+		Agent->Stop();
+		return true;
+	}));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAgentEventsTestStopDuringLongPoll, "Diversion.Tests.AgentEvents.StopDuringLongPoll",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FAgentEventsTestStopDuringLongPoll::RunTest(const FString& Parameters)
+{
+	TSharedRef<FStandInAgent> Agent = MakeShared<FStandInAgent>();
+	if (!TestTrue(TEXT("Stand-in agent should start"), Agent->Start()))
+	{
+		return false;
+	}
+
+	auto ApiClient = MakeShared<DiversionHttp::FHttpRequestManager>(TEXT("127.0.0.1"), FString::FromInt(StandInAgentPort),
+		TMap<FString, FString>(), false);
+	TSharedPtr<FDiversionAgentEventSubscription> Subscription = MakeShared<FDiversionAgentEventSubscription>(
+		MakeShared<Diversion::AgentAPI::DefaultApi>(ApiClient), TEXT("dv.repo.test"), TEXT("dv.ws.test"), WorkspacePath);
+	TWeakPtr<FDiversionAgentEventSubscription> WeakSubscription = Subscription;
+	Subscription->Start();
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand(WaitFor(this, TEXT("the long poll"), [Agent]() {
+		return Agent->NumEventRequests > 0;
+	})));
+
+	// Dropping the subscription in the middle of a long poll returns right away, the thread keeps it alive meanwhile
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Subscription, WeakSubscription]() mutable {
+		const double StartTime = FPlatformTime::Seconds();
+		Subscription->RequestStop();
+		Subscription.Reset();
+		TestTrue(TEXT("Dropping the subscription shouldn't wait for the long poll"), FPlatformTime::Seconds() - StartTime < 0.1);
+		TestTrue(TEXT("The subscription should live until its thread returned"), WeakSubscription.IsValid());
+		return true;
+	}));
+
+	// Once the poll returns, the thread exits and releases the subscription
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([Agent]() {
+		Agent->bRespondImmediately = true;
+		Agent->RespondToHeldEvents(TEXT("[]"));
+		return true;
+	}));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand(WaitFor(this, TEXT("the subscription to be released"), [WeakSubscription]() {
+		return !WeakSubscription.IsValid();
+	})));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([Agent]() {
+		Agent->Stop();
+		return true;
+	}));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAgentEventsTestVersionOutlivesExpiry, "Diversion.Tests.AgentEvents.VersionOutlivesExpiry",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FAgentEventsTestVersionOutlivesExpiry::RunTest(const FString& Parameters)
+{
+	constexpr double SecondsConnected = 3.0;
+	TSharedRef<FStandInAgent> Agent = MakeShared<FStandInAgent>();
+	if (!TestTrue(TEXT("Stand-in agent should start"), Agent->Start()))
+	{
+		return false;
+	}
+
+	auto ApiClient = MakeShared<DiversionHttp::FHttpRequestManager>(TEXT("127.0.0.1"), FString::FromInt(StandInAgentPort),
+		TMap<FString, FString>(), false);
+	TSharedRef<FDiversionAgentEventSubscription> Subscription = MakeShared<FDiversionAgentEventSubscription>(
+		MakeShared<Diversion::AgentAPI::DefaultApi>(ApiClient), TEXT("dv.repo.test"), TEXT("dv.ws.test"), WorkspacePath);
+	// Expires well before the stream ends, and nothing but the stream refreshes it
+	TSharedRef<TCached<FDiversionVersion>> AgentVersion = MakeShared<TCached<FDiversionVersion>>(FDiversionVersion(""),
+		FTimespan::FromSeconds(0.2), FTimespan::FromSeconds(1));
+	FDiversionVersion Version(TEXT("v1.2.3"));
+	Version.SetAgentAlive(true);
+	AgentVersion->Set(Version);
+	Subscription->Start();
+
+	// The agent answers a long poll every frame, like a busy workspace
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Agent, Subscription, AgentVersion, StartTime = 0.0]() mutable {
+		if (StartTime == 0.0)
+		{
+			StartTime = FPlatformTime::Seconds();
+		}
+		Agent->RespondToHeldEvents(TEXT("[]"));
+		Subscription->RefreshAgentVersion(*AgentVersion);
+		if (!AgentVersion->GetUnexpired(FDiversionVersion("")).IsValid())
+		{
+			AddError(FString::Printf(TEXT("The agent version expired after %.1f seconds of connected events"), FPlatformTime::Seconds() - StartTime));
+			return true;
+		}
+		return FPlatformTime::Seconds() - StartTime > SecondsConnected;
+	}));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Subscription, AgentVersion]() {
+		TestTrue(TEXT("Subscription should be connected"), Subscription->IsConnected());
+		TestEqual(TEXT("The refreshed version should be the one the health check set"), AgentVersion->Get().ToString(), FString(TEXT("1.2.3")));
+		return true;
+	}));
+
+	// Shut down
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([Agent, Subscription]() {
+		Subscription->RequestStop();
+		Agent->bRespondImmediately = true;
+		Agent->RespondToHeldEvents(TEXT("[]"));
+		return true;
+	}));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand(WaitFor(this, TEXT("the subscription to stop"), [Subscription]() {
+		return !Subscription->IsRunning();
+	})));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([Agent]() {
+		Agent->Stop();
+		return true;
+	}));
+
+	return true;
+}
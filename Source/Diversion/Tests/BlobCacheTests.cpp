@@ -0,0 +1,219 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Tasks/Task.h"
+#include "DiversionBlobCache.h"
+
+#include <atomic>
+
+namespace
+{
+	constexpr int64 BlobSize = 100;
+
+	/** A blob cache in its own transient directory, deleted with it */
+	struct FScopedBlobCacheDir
+	{
+		const FString Dir = FPaths::AutomationTransientDir() / TEXT("DiversionBlobCacheTests") / FGuid::NewGuid().ToString();
+
+		~FScopedBlobCacheDir()
+		{
+			IFileManager::Get().DeleteDirectory(*Dir, false, true);
+		}
+
+		FString GetDestPath(const FString& InName) const
+		{
+			return Dir / TEXT("Dest") / InName;
+		}
+	};
+
+	TArray<uint8> MakeBlob(uint8 InFill)
+	{
+		TArray<uint8> Blob;
+		Blob.Init(InFill, BlobSize);
+		return Blob;
+	}
+
+	/** Writes a blob to a fresh temp file of the cache, like a completed download */
+	FString WriteTempBlob(const FDiversionBlobCache& InCache, const FString& InSha, const TArray<uint8>& InBlob)
+	{
+		const FString TempPath = InCache.MakeTempPath(InSha);
+		FFileHelper::SaveArrayToFile(InBlob, *TempPath);
+		return TempPath;
+	}
+
+	bool FileEquals(const FString& InPath, const TArray<uint8>& InExpected)
+	{
+		TArray<uint8> Contents;
+		return FFileHelper::LoadFileToArray(Contents, *InPath, FILEREAD_Silent) && Contents == InExpected;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlobCacheTestLeastRecentlyUsedEviction, "Diversion.Tests.BlobCache.LeastRecentlyUsedEviction",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FBlobCacheTestLeastRecentlyUsedEviction::RunTest(const FString& Parameters)
+{
+	FScopedBlobCacheDir CacheDir;
+	FDiversionBlobCache Cache(CacheDir.Dir);
+	// Room for two blobs, admitting a third evicts down to the low watermark
+	const int64 MaxBytes = BlobSize * 5 / 2;
+
+	TestTrue(TEXT("Admit A"), Cache.Admit(TEXT("blobA"), WriteTempBlob(Cache, TEXT("blobA"), MakeBlob('A')), CacheDir.GetDestPath(TEXT("A")), MaxBytes));
+	FPlatformProcess::Sleep(0.01f);
+	TestTrue(TEXT("Admit B"), Cache.Admit(TEXT("blobB"), WriteTempBlob(Cache, TEXT("blobB"), MakeBlob('B')), CacheDir.GetDestPath(TEXT("B")), MaxBytes));
+	FPlatformProcess::Sleep(0.01f);
+	// A is now more recently used than B
+	TestTrue(TEXT("Fetch A"), Cache.Fetch(TEXT("blobA"), BlobSize, CacheDir.GetDestPath(TEXT("A"))));
+	FPlatformProcess::Sleep(0.01f);
+	TestTrue(TEXT("Admit C"), Cache.Admit(TEXT("blobC"), WriteTempBlob(Cache, TEXT("blobC"), MakeBlob('C')), CacheDir.GetDestPath(TEXT("C")), MaxBytes));
+
+	TestFalse(TEXT("The least recently used blob should be evicted"), Cache.Fetch(TEXT("blobB"), BlobSize, CacheDir.GetDestPath(TEXT("B2"))));
+	TestTrue(TEXT("A recently fetched blob should be kept"), Cache.Fetch(TEXT("blobA"), BlobSize, CacheDir.GetDestPath(TEXT("A2"))));
+	TestTrue(TEXT("The admitted blob should be kept"), Cache.Fetch(TEXT("blobC"), BlobSize, CacheDir.GetDestPath(TEXT("C2"))));
+	TestTrue(TEXT("The fetched blob should have its content"), FileEquals(CacheDir.GetDestPath(TEXT("A2")), MakeBlob('A')));
+
+	// A blob bigger than the low watermark is still placed, and never evicts itself
+	TArray<uint8> LargeBlob;
+	LargeBlob.Init('L', MaxBytes - 1);
+	TestTrue(TEXT("Admit a large blob"), Cache.Admit(TEXT("blobL"), WriteTempBlob(Cache, TEXT("blobL"), LargeBlob), CacheDir.GetDestPath(TEXT("L")), MaxBytes));
+	TestTrue(TEXT("The large blob should be placed"), FileEquals(CacheDir.GetDestPath(TEXT("L")), LargeBlob));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlobCacheTestCopiesAreIndependent, "Diversion.Tests.BlobCache.CopiesAreIndependent",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FBlobCacheTestCopiesAreIndependent::RunTest(const FString& Parameters)
+{
+	FScopedBlobCacheDir CacheDir;
+	FDiversionBlobCache Cache(CacheDir.Dir);
+	const FString DestPath = CacheDir.GetDestPath(TEXT("A"));
+	TestTrue(TEXT("Admit A"), Cache.Admit(TEXT("blobA"), WriteTempBlob(Cache, TEXT("blobA"), MakeBlob('A')), DestPath, BlobSize * 10));
+
+	// Whatever the diff tool does with its file, the cached blob stays intact
+	TUniquePtr<IFileHandle> Handle(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*DestPath, true));
+	if (TestTrue(TEXT("The placed blob should be writable"), Handle.IsValid()))
+	{
+		const TArray<uint8> Garbage = MakeBlob('X');
+		Handle->Seek(0);
+		Handle->Write(Garbage.GetData(), Garbage.Num());
+		Handle.Reset();
+	}
+
+	const FString SecondDestPath = CacheDir.GetDestPath(TEXT("A2"));
+	TestTrue(TEXT("The blob should still be cached"), Cache.Fetch(TEXT("blobA"), BlobSize, SecondDestPath));
+	TestTrue(TEXT("Writing to a placed blob shouldn't modify the cache"), FileEquals(SecondDestPath, MakeBlob('A')));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlobCacheTestConcurrentAdmitAndFetch, "Diversion.Tests.BlobCache.ConcurrentAdmitAndFetch",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FBlobCacheTestConcurrentAdmitAndFetch::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumTasks = 8;
+	constexpr int32 NumIterations = 50;
+	constexpr int32 NumShas = 6;
+	FScopedBlobCacheDir CacheDir;
+	FDiversionBlobCache Cache(CacheDir.Dir);
+	// Smaller than all the blobs, so the evictions race the fetches
+	const int64 MaxBytes = BlobSize * 4;
+
+	std::atomic<int32> NumFailedAdmits{0};
+	std::atomic<int32> NumCorruptedFetches{0};
+	TArray<UE::Tasks::TTask<void>> Tasks;
+	for (int32 TaskIndex = 0; TaskIndex < NumTasks; ++TaskIndex)
+	{
+		Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [&, TaskIndex]()
+		{
+			for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+			{
+				const int32 ShaIndex = (TaskIndex + Iteration) % NumShas;
+				const FString Sha = FString::Printf(TEXT("blob%d"), ShaIndex);
+				const TArray<uint8> Blob = MakeBlob('a' + ShaIndex);
+				const FString DestPath = CacheDir.GetDestPath(FString::Printf(TEXT("%d-%d"), TaskIndex, Iteration));
+				if (Cache.Fetch(Sha, BlobSize, DestPath))
+				{
+					NumCorruptedFetches += FileEquals(DestPath, Blob) ? 0 : 1;
+				}
+				else if (!Cache.Admit(Sha, WriteTempBlob(Cache, Sha, Blob), DestPath, MaxBytes))
+				{
+					++NumFailedAdmits;
+				}
+				else
+				{
+					NumCorruptedFetches += FileEquals(DestPath, Blob) ? 0 : 1;
+				}
+			}
+		}));
+	}
+	UE::Tasks::Wait(Tasks);
+
+	TestEqual(TEXT("Admits racing each other and the evictions should all place their blob"), NumFailedAdmits.load(), 0);
+	TestEqual(TEXT("Fetches racing the admits and the evictions should never place a wrong blob"), NumCorruptedFetches.load(), 0);
+
+	TArray<FString> TempFiles;
+	IFileManager::Get().FindFiles(TempFiles, *(CacheDir.Dir / TEXT("*.tmp")), true, false);
+	TestTrue(TEXT("Every temp file should be consumed"), TempFiles.IsEmpty());
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlobCacheTestStaleTempCleanup, "Diversion.Tests.BlobCache.StaleTempCleanup",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FBlobCacheTestStaleTempCleanup::RunTest(const FString& Parameters)
+{
+	FScopedBlobCacheDir CacheDir;
+	FString StaleTempPath;
+	{
+		// A previous session that cached a blob and crashed during a download
+		FDiversionBlobCache PreviousCache(CacheDir.Dir);
+		TestTrue(TEXT("Admit A"), PreviousCache.Admit(TEXT("blobA"), WriteTempBlob(PreviousCache, TEXT("blobA"), MakeBlob('A')),
+			CacheDir.GetDestPath(TEXT("A")), BlobSize * 10));
+		StaleTempPath = WriteTempBlob(PreviousCache, TEXT("blobB"), MakeBlob('B'));
+	}
+
+	FDiversionBlobCache Cache(CacheDir.Dir);
+	TestTrue(TEXT("Blobs of a previous session should be found"), Cache.Fetch(TEXT("blobA"), BlobSize, CacheDir.GetDestPath(TEXT("A2"))));
+	TestFalse(TEXT("Interrupted downloads should be deleted"), FPaths::FileExists(StaleTempPath));
+	TestFalse(TEXT("Interrupted downloads should never be served"), Cache.Fetch(TEXT("blobB"), BlobSize, CacheDir.GetDestPath(TEXT("B"))));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlobCacheTestModifiedBlobsDropped, "Diversion.Tests.BlobCache.ModifiedBlobsDropped",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FBlobCacheTestModifiedBlobsDropped::RunTest(const FString& Parameters)
+{
+	FScopedBlobCacheDir CacheDir;
+	{
+		// A previous session that cached the blobs
+		FDiversionBlobCache PreviousCache(CacheDir.Dir);
+		for (const TCHAR* Sha : { TEXT("blobA"), TEXT("blobB"), TEXT("blobC") })
+		{
+			TestTrue(FString::Printf(TEXT("Admit %s"), Sha), PreviousCache.Admit(Sha, WriteTempBlob(PreviousCache, Sha, MakeBlob('A')),
+				CacheDir.GetDestPath(Sha), BlobSize * 10));
+		}
+	}
+	// Same size, other content - only the digest tells them apart
+	FFileHelper::SaveArrayToFile(MakeBlob('X'), *(CacheDir.Dir / TEXT("blobB")));
+	// Cached without a digest, its content is unknown
+	IFileManager::Get().Delete(*(CacheDir.Dir / TEXT("Digests") / TEXT("blobC")));
+
+	FDiversionBlobCache Cache(CacheDir.Dir);
+	TestTrue(TEXT("An intact blob of a previous session should be served"), Cache.Fetch(TEXT("blobA"), BlobSize, CacheDir.GetDestPath(TEXT("A2"))));
+	TestFalse(TEXT("A blob modified since a previous session should never be served"), Cache.Fetch(TEXT("blobB"), BlobSize, CacheDir.GetDestPath(TEXT("B2"))));
+	TestFalse(TEXT("The modified blob shouldn't be placed"), FPaths::FileExists(CacheDir.GetDestPath(TEXT("B2"))));
+	TestFalse(TEXT("The modified blob should be dropped from the cache"), FPaths::FileExists(CacheDir.Dir / TEXT("blobB")));
+	TestFalse(TEXT("A blob without its digest should never be served"), Cache.Fetch(TEXT("blobC"), BlobSize, CacheDir.GetDestPath(TEXT("C2"))));
+
+	// Modified during the session, after it was served once
+	FFileHelper::SaveArrayToFile(MakeBlob('X'), *(CacheDir.Dir / TEXT("blobA")));
+	TestFalse(TEXT("A blob modified during the session should never be served"), Cache.Fetch(TEXT("blobA"), BlobSize, CacheDir.GetDestPath(TEXT("A3"))));
+	return true;
+}
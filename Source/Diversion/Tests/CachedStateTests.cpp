@@ -2,6 +2,9 @@
 
 #include "Misc/AutomationTest.h"
 #include "CachedState.h"
+#include "Async/ParallelFor.h"
+
+#include <atomic>
 
 DEFINE_LOG_CATEGORY_STATIC(LogCachedStateTests, Log, All);
 
@@ -13,8 +16,8 @@ bool FCachedStateTestGetValid::RunTest(const FString& Parameters)
 {
 	// Test Case 1: GetValid() should return nullptr initially
 	TCached<bool> CachedBool(false, FTimespan::FromSeconds(1));
-	const bool* Value = CachedBool.GetValid();
-	return TestTrue(TEXT("GetValid() should return nullptr initially"), Value == nullptr);
+	const TOptional<bool> Value = CachedBool.GetValid();
+	return TestTrue(TEXT("GetValid() should return nullptr initially"), !Value.IsSet());
 }
 
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCachedStateTestSetGetValid, "Diversion.Tests.CachedState.SetGetValid",
@@ -26,9 +29,9 @@ bool FCachedStateTestSetGetValid::RunTest(const FString& Parameters)
 	// Test Case 2: GetValid() should return the value after a set
 	TCached<bool> CachedBool(false, FTimespan::FromSeconds(2));
 	CachedBool.Set(true);
-	const bool* Value = CachedBool.GetValid();
-	bSuccess &= TestTrue(TEXT("GetValid() should return the value after Set()"), Value != nullptr);
-	bSuccess &= TestEqual(TEXT("GetValid() should return the correct value after Set()"), *Value, true);
+	const TOptional<bool> Value = CachedBool.GetValid();
+	bSuccess &= TestTrue(TEXT("GetValid() should return the value after Set()"), Value.IsSet());
+	bSuccess &= TestEqual(TEXT("GetValid() should return the correct value after Set()"), Value.Get(false), true);
 	return bSuccess;
 }
 
@@ -43,8 +46,8 @@ bool FCachedStateTestSetGetValidTimeout::RunTest(const FString& Parameters)
 
 	// Wait for the cache to expire and verify that GetValid() returns a nullptr
 	FPlatformProcess::Sleep(3);
-	const bool* Value = CachedBool.GetValid();
-	bSuccess &= TestTrue(TEXT("GetValid() should return the value after Set()"), Value == nullptr);
+	const TOptional<bool> Value = CachedBool.GetValid();
+	bSuccess &= TestTrue(TEXT("GetValid() should return the value after Set()"), !Value.IsSet());
 	return bSuccess;
 }
 
@@ -83,3 +86,109 @@ bool FCachedStateTestGetUpdate::RunTest(const FString& Parameters)
 	
 	return true;
 }
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCachedStateTestStaleWhileRevalidate, "Diversion.Tests.CachedState.StaleWhileRevalidate",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FCachedStateTestStaleWhileRevalidate::RunTest(const FString& Parameters)
+{
+	TCached<int> CachedInt(0, FTimespan::FromSeconds(1));
+	CachedInt.Set(1);
+	int NumRefreshes = 0;
+	// An asynchronous refresh - doesn't set the value by the time GetUpdate() returns
+	FOnCacheUpdate OnCacheUpdateDelegate;
+	OnCacheUpdateDelegate.BindLambda([&]()
+	{
+		NumRefreshes++;
+	});
+
+	FPlatformProcess::Sleep(2);
+	TestEqual(TEXT("GetUpdate() should return the stale value while refreshing"), CachedInt.GetUpdate(0, OnCacheUpdateDelegate), 1);
+	TestEqual(TEXT("GetUpdate() should start a refresh of a stale value"), NumRefreshes, 1);
+	TestTrue(TEXT("The refresh should be in flight"), CachedInt.IsRefreshInFlight());
+
+	TestEqual(TEXT("GetUpdate() should return the stale value while refreshing"), CachedInt.GetUpdate(0, OnCacheUpdateDelegate), 1);
+	TestEqual(TEXT("GetUpdate() should not start another refresh while one is in flight"), NumRefreshes, 1);
+
+	// The refresh completes
+	CachedInt.Set(2);
+	TestFalse(TEXT("Set() should complete the refresh"), CachedInt.IsRefreshInFlight());
+	TestEqual(TEXT("GetUpdate() should return the refreshed value"), CachedInt.GetUpdate(0, OnCacheUpdateDelegate), 2);
+	TestEqual(TEXT("GetUpdate() should not refresh a fresh value"), NumRefreshes, 1);
+
+	CachedInt.GetUpdate(0, OnCacheUpdateDelegate, true);
+	TestEqual(TEXT("GetUpdate() should always refresh if forced"), NumRefreshes, 2);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCachedStateTestHardExpiry, "Diversion.Tests.CachedState.HardExpiry",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FCachedStateTestHardExpiry::RunTest(const FString& Parameters)
+{
+	TCached<int> CachedInt(0, FTimespan::FromSeconds(1), FTimespan::FromSeconds(2));
+	CachedInt.Set(1);
+	FOnCacheUpdate OnCacheUpdateDelegate;
+	OnCacheUpdateDelegate.BindLambda([]() {});
+
+	FPlatformProcess::Sleep(1.5f);
+	TestEqual(TEXT("GetUpdate() should return the stale value before the hard expiry"), CachedInt.GetUpdate(-1, OnCacheUpdateDelegate), 1);
+	TestEqual(TEXT("GetUnexpired() should return the stale value before the hard expiry"), CachedInt.GetUnexpired(-1), 1);
+
+	FPlatformProcess::Sleep(1.5f);
+	TestEqual(TEXT("GetUpdate() should return the nil value past the hard expiry"), CachedInt.GetUpdate(-1, OnCacheUpdateDelegate), -1);
+	TestEqual(TEXT("GetUnexpired() should return the nil value past the hard expiry"), CachedInt.GetUnexpired(-1), -1);
+	TestEqual(TEXT("Get() should still return the last value"), CachedInt.Get(), 1);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCachedStateTestConcurrentRefresh, "Diversion.Tests.CachedState.ConcurrentRefresh",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FCachedStateTestConcurrentRefresh::RunTest(const FString& Parameters)
+{
+	// Never set - stale from the start
+	TCached<int> CachedInt(0, FTimespan::FromSeconds(60));
+	std::atomic<int32> NumRefreshes = 0;
+	FOnCacheUpdate OnCacheUpdateDelegate;
+	OnCacheUpdateDelegate.BindLambda([&]()
+	{
+		++NumRefreshes;
+	});
+
+	ParallelFor(1000, [&](int32)
+	{
+		CachedInt.GetUpdate(0, OnCacheUpdateDelegate);
+	});
+
+	return TestEqual(TEXT("Concurrent GetUpdate() calls should start exactly one refresh"), NumRefreshes.load(), 1);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCachedStateTestConcurrentReadWrite, "Diversion.Tests.CachedState.ConcurrentReadWrite",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FCachedStateTestConcurrentReadWrite::RunTest(const FString& Parameters)
+{
+	const FString ValueA = FString::ChrN(256, TEXT('a'));
+	const FString ValueB = FString::ChrN(256, TEXT('b'));
+	TCached<FString> CachedString(ValueA, FTimespan::FromSeconds(60));
+	std::atomic<int32> NumTornReads = 0;
+
+	// Writers and readers interleaved - a read must see either value as a whole
+	ParallelFor(10000, [&](int32 Index)
+	{
+		if (Index % 4 == 0)
+		{
+			CachedString.Set(Index % 8 == 0 ? ValueA : ValueB);
+			return;
+		}
+
+		const FString Value = Index % 2 == 0 ? CachedString.Get() : CachedString.GetUpdate(ValueA);
+		if (Value != ValueA && Value != ValueB)
+		{
+			++NumTornReads;
+		}
+	});
+
+	return TestEqual(TEXT("Concurrent reads should never see a partially written value"), NumTornReads.load(), 0);
+}
@@ -0,0 +1,120 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "SourceControlOperationBase.h"
+#include "DiversionCommand.h"
+#include "DiversionConstants.h"
+#include "DiversionModule.h"
+#include "DiversionProvider.h"
+#include "IDiversionWorker.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCommandCompletionTests, Log, All);
+
+namespace
+{
+	constexpr int32 NumRoundTrips = 100;
+	const FName StubOperationName = TEXT("DiversionCommandCompletionTest");
+
+	/** No progress string, so the synchronous execution doesn't open a progress dialog */
+	class FStubOperation final : public FSourceControlOperationBase
+	{
+	public:
+		virtual FName GetName() const override { return StubOperationName; }
+		virtual FText GetInProgressString() const override { return FText::GetEmpty(); }
+	};
+
+	/** Completes right away on the command thread, after an optional delay */
+	class FStubWorker final : public IDiversionWorker
+	{
+	public:
+		FStubWorker(bool bInSucceed, float InDelaySeconds)
+			: bSucceed(bInSucceed), DelaySeconds(InDelaySeconds) {}
+
+		virtual FName GetName() const override { return StubOperationName; }
+		virtual bool Execute(FDiversionCommand& InCommand) override
+		{
+			if (DelaySeconds > 0.0f)
+			{
+				FPlatformProcess::Sleep(DelaySeconds);
+			}
+			InCommand.InfoMessages.Add(TEXT("Stub worker ran"));
+			InCommand.MarkOperationCompleted(bSucceed);
+			return bSucceed;
+		}
+		// Nothing to update, and no sync status or package side effects on the real provider
+		virtual bool UpdateStates() const override { return false; }
+
+	private:
+		const bool bSucceed;
+		const float DelaySeconds;
+	};
+
+	/** Registers the stub worker on the real provider for the scope of a test */
+	struct FScopedStubWorker
+	{
+		FScopedStubWorker(bool bSucceed, float DelaySeconds = 0.0f)
+		{
+			FDiversionModule::Get().GetProvider().RegisterWorker(StubOperationName,
+				FGetDiversionWorker::CreateLambda([bSucceed, DelaySeconds]() -> FDiversionWorkerRef {
+					return MakeShared<FStubWorker, ESPMode::ThreadSafe>(bSucceed, DelaySeconds);
+				}));
+		}
+		~FScopedStubWorker()
+		{
+			FDiversionModule::Get().GetProvider().UnregisterWorker(StubOperationName);
+		}
+	};
+
+	ECommandResult::Type ExecuteStub(TSharedRef<FStubOperation, ESPMode::ThreadSafe> InOperation, int32& OutNumCompletions)
+	{
+		return FDiversionModule::Get().GetProvider().Execute(InOperation, nullptr, TArray<FString>(), EConcurrency::Synchronous,
+			FSourceControlOperationComplete::CreateLambda([&OutNumCompletions](const FSourceControlOperationRef&, ECommandResult::Type) {
+				++OutNumCompletions;
+			}));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCommandCompletionTestSynchronous, "Diversion.Tests.CommandCompletion.Synchronous",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FCommandCompletionTestSynchronous::RunTest(const FString& Parameters)
+{
+	{
+		FScopedStubWorker StubWorker(true, 0.2f);
+		TSharedRef<FStubOperation, ESPMode::ThreadSafe> Operation = ISourceControlOperation::Create<FStubOperation>();
+		int32 NumCompletions = 0;
+		TestEqual(TEXT("A synchronous command should return once its worker succeeded"), ExecuteStub(Operation, NumCompletions), ECommandResult::Succeeded);
+		TestEqual(TEXT("The completion delegate should run once, before returning"), NumCompletions, 1);
+		TestEqual(TEXT("The worker messages should be returned to the operation"), Operation->GetResultInfo().InfoMessages.Num(), 1);
+	}
+	{
+		FScopedStubWorker StubWorker(false);
+		int32 NumCompletions = 0;
+		TestEqual(TEXT("A synchronous command should return the failure of its worker"),
+			ExecuteStub(ISourceControlOperation::Create<FStubOperation>(), NumCompletions), ECommandResult::Failed);
+		TestEqual(TEXT("The completion delegate should run on failures too"), NumCompletions, 1);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCommandCompletionTestLatency, "Diversion.Tests.CommandCompletion.Latency",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FCommandCompletionTestLatency::RunTest(const FString& Parameters)
+{
+	FScopedStubWorker StubWorker(true);
+	int32 NumCompletions = 0;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < NumRoundTrips; ++Index)
+	{
+		ExecuteStub(ISourceControlOperation::Create<FStubOperation>(), NumCompletions);
+	}
+	const double Latency = (FPlatformTime::Seconds() - StartTime) / NumRoundTrips;
+
+	UE_LOG(LogCommandCompletionTests, Display, TEXT("Synchronous command round trip: %.3f ms (%d commands)"), Latency * 1000.0, NumRoundTrips);
+
+	TestEqual(TEXT("Every command should have completed"), NumCompletions, NumRoundTrips);
+	// The completion event wakes the waiter as soon as the worker is done, it never sits out the progress tick
+	return TestTrue(TEXT("Synchronous commands should complete faster than the progress tick"),
+		Latency * 1000.0 < MILLISECONDS_SYNCHRONOUS_COMMAND_PROGRESS_TICK);
+}
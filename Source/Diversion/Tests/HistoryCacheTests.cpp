@@ -0,0 +1,94 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "DiversionConstants.h"
+#include "DiversionHistoryCache.h"
+
+namespace
+{
+	/** A history of the given commits, newest first */
+	TDiversionHistory MakeHistory(std::initializer_list<const TCHAR*> InCommitIds)
+	{
+		TDiversionHistory History;
+		for (const TCHAR* CommitId : InCommitIds)
+		{
+			TSharedRef<FDiversionRevision, ESPMode::ThreadSafe> Revision = MakeShared<FDiversionRevision>();
+			Revision->CommitId = CommitId;
+			History.Add(MoveTemp(Revision));
+		}
+		return History;
+	}
+
+	TArray<FString> GetCommitIds(const TDiversionHistory& InHistory)
+	{
+		TArray<FString> CommitIds;
+		for (const TSharedRef<FDiversionRevision, ESPMode::ThreadSafe>& Revision : InHistory)
+		{
+			CommitIds.Add(Revision->CommitId);
+		}
+		return CommitIds;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHistoryCacheTestMergeNewest, "Diversion.Tests.HistoryCache.MergeNewest",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FHistoryCacheTestMergeNewest::RunTest(const FString& Parameters)
+{
+	const TDiversionHistory Cached = MakeHistory({TEXT("dv.commit.3"), TEXT("dv.commit.2"), TEXT("dv.commit.1")});
+	{
+		TDiversionHistory History;
+		TestTrue(TEXT("The newest page reaching the cached head should merge"),
+			FDiversionHistoryCache::MergeNewest(Cached, MakeHistory({TEXT("dv.commit.5"), TEXT("dv.commit.4"), TEXT("dv.commit.3"), TEXT("dv.commit.2")}), History));
+		TestEqual(TEXT("The new revisions should be prepended to the cached ones, without duplicates"), GetCommitIds(History),
+			TArray<FString>({TEXT("dv.commit.5"), TEXT("dv.commit.4"), TEXT("dv.commit.3"), TEXT("dv.commit.2"), TEXT("dv.commit.1")}));
+	}
+	{
+		TDiversionHistory History;
+		TestTrue(TEXT("An unchanged history should merge"),
+			FDiversionHistoryCache::MergeNewest(Cached, MakeHistory({TEXT("dv.commit.3"), TEXT("dv.commit.2")}), History));
+		TestEqual(TEXT("An unchanged history should be the cached one"), GetCommitIds(History), GetCommitIds(Cached));
+	}
+	{
+		// More new commits than the page holds
+		TDiversionHistory History;
+		TestFalse(TEXT("A newest page missing the cached head shouldn't merge"),
+			FDiversionHistoryCache::MergeNewest(Cached, MakeHistory({TEXT("dv.commit.7"), TEXT("dv.commit.6"), TEXT("dv.commit.5")}), History));
+	}
+	{
+		// The workspace switched to a branch that shares older commits, but not the cached head
+		TDiversionHistory History;
+		TestFalse(TEXT("A branch switch should never merge the revisions of the other branch"),
+			FDiversionHistoryCache::MergeNewest(Cached, MakeHistory({TEXT("dv.commit.8"), TEXT("dv.commit.2"), TEXT("dv.commit.1")}), History));
+	}
+	{
+		TDiversionHistory History;
+		TestFalse(TEXT("An empty newest page shouldn't merge"), FDiversionHistoryCache::MergeNewest(Cached, TDiversionHistory(), History));
+		TestFalse(TEXT("An empty cached history shouldn't merge"), FDiversionHistoryCache::MergeNewest(TDiversionHistory(), Cached, History));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHistoryCacheTestLongHistoriesNotCached, "Diversion.Tests.HistoryCache.LongHistoriesNotCached",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FHistoryCacheTestLongHistoriesNotCached::RunTest(const FString& Parameters)
+{
+	// Not a valid workspace, so the cache never touches the disk
+	const WorkspaceInfo WsInfo;
+	const FString File = TEXT("Content/Long.uasset");
+	FDiversionHistoryCache Cache;
+	TDiversionHistory History;
+
+	Cache.Update(WsInfo, File, MakeHistory({TEXT("dv.commit.1")}));
+	TestTrue(TEXT("A short history should be cached"), Cache.Find(WsInfo, File, History));
+
+	TDiversionHistory LongHistory;
+	for (int32 Index = MAX_CACHED_HISTORY_REVISIONS + 1; Index > 0; --Index)
+	{
+		LongHistory.Append(MakeHistory({*FString::Printf(TEXT("dv.commit.%d"), Index)}));
+	}
+	Cache.Update(WsInfo, File, LongHistory);
+	TestFalse(TEXT("A history too long to cache should drop the cached one, never cache it partially"), Cache.Find(WsInfo, File, History));
+	return true;
+}
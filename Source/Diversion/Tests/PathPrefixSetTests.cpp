@@ -0,0 +1,152 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "DiversionPathPrefixSet.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogPathPrefixSetTests, Log, All);
+
+namespace
+{
+	const FString WorkspacePath = TEXT("/Workspace");
+
+	/** The previous lookup - every path checked against every requested path */
+	bool IsPathContainedLinear(const FString& InPath, const TArray<FString>& InCommandPaths)
+	{
+		for (const FString& CommandPath : InCommandPaths)
+		{
+			if (FPaths::IsUnderDirectory(InPath, CommandPath))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** Assets spread over nested directories, like a large selection in the content browser */
+	TArray<FString> MakeAssetPaths(int32 InNum, const TCHAR* InPrefix)
+	{
+		TArray<FString> Paths;
+		Paths.Reserve(InNum);
+		for (int32 Index = 0; Index < InNum; ++Index)
+		{
+			Paths.Add(FString::Printf(TEXT("%s/Content/Dir%d/Sub%d/%s%d.uasset"), *WorkspacePath, Index % 97, Index % 13, InPrefix, Index));
+		}
+		return Paths;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPathPrefixSetTestContains, "Diversion.Tests.PathPrefixSet.Contains",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPathPrefixSetTestContains::RunTest(const FString& Parameters)
+{
+	const TArray<FString> CommandPaths = {
+		WorkspacePath / TEXT("Content/Maps"),
+		WorkspacePath / TEXT("Content/Props/"),
+		WorkspacePath / TEXT("Config/DefaultEngine.ini"),
+	};
+	const FDiversionPathPrefixSet PrefixSet(CommandPaths);
+
+	const TArray<FString> Queries = {
+		WorkspacePath / TEXT("Content/Maps"),
+		WorkspacePath / TEXT("Content/Maps/Main.umap"),
+		WorkspacePath / TEXT("Content/Maps/Sub/Level.umap"),
+		WorkspacePath / TEXT("Content/MapsOld/Main.umap"),
+		WorkspacePath / TEXT("Content/Props/Chair.uasset"),
+		WorkspacePath / TEXT("Content/Prop.uasset"),
+		WorkspacePath / TEXT("Config/DefaultEngine.ini"),
+		WorkspacePath / TEXT("Config/DefaultGame.ini"),
+		WorkspacePath / TEXT("Content"),
+		WorkspacePath,
+	};
+	for (const FString& Query : Queries)
+	{
+		TestEqual(*FString::Printf(TEXT("Containment of %s"), *Query), PrefixSet.Contains(Query), IsPathContainedLinear(Query, CommandPaths));
+	}
+
+	const FDiversionPathPrefixSet WorkspaceSet({ WorkspacePath });
+	TestTrue(TEXT("The workspace root contains everything under it"), WorkspaceSet.Contains(WorkspacePath / TEXT("Content/Maps/Main.umap")));
+	TestFalse(TEXT("An empty set contains nothing"), FDiversionPathPrefixSet().Contains(WorkspacePath));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPathPrefixSetTestCase, "Diversion.Tests.PathPrefixSet.Case",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FPathPrefixSetTestCase::RunTest(const FString& Parameters)
+{
+	const TArray<FString> CommandPaths = {
+		WorkspacePath / TEXT("Content/Maps"),
+		WorkspacePath / TEXT("Config/DefaultEngine.ini"),
+	};
+	const FDiversionPathPrefixSet PrefixSet(CommandPaths);
+
+	// Only differing in case from the paths of the set, or from their ancestors
+	const TArray<FString> Queries = {
+		WorkspacePath / TEXT("Content/maps"),
+		WorkspacePath / TEXT("Content/MAPS/Main.umap"),
+		WorkspacePath / TEXT("content/Maps/Main.umap"),
+		WorkspacePath / TEXT("Config/defaultengine.ini"),
+	};
+	for (const FString& Query : Queries)
+	{
+		TestEqual(*FString::Printf(TEXT("Containment of %s"), *Query), PrefixSet.Contains(Query), IsPathContainedLinear(Query, CommandPaths));
+#if PLATFORM_WINDOWS
+		TestTrue(*FString::Printf(TEXT("%s should match regardless of case"), *Query), PrefixSet.Contains(Query));
+#else
+		TestFalse(*FString::Printf(TEXT("%s should only match in the same case"), *Query), PrefixSet.Contains(Query));
+#endif
+	}
+
+	// Both spellings are distinct paths where the file system is case sensitive
+	FDiversionPathPrefixSet BothCases(CommandPaths);
+	BothCases.Add(WorkspacePath / TEXT("Content/maps"));
+#if PLATFORM_WINDOWS
+	TestEqual(TEXT("Paths differing in case should be the same entry"), BothCases.Num(), 2);
+#else
+	TestEqual(TEXT("Paths differing in case should be distinct entries"), BothCases.Num(), 3);
+#endif
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPathPrefixSetTestBenchmark, "Diversion.Tests.PathPrefixSet.Benchmark",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FPathPrefixSetTestBenchmark::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumCommandPaths = 10000;
+	constexpr int32 NumStatusItems = 10000;
+	// The linear lookup takes minutes at full size, it's timed on a sample and extrapolated
+	constexpr int32 NumLinearSamples = 200;
+
+	// Half of the status items were requested, the other half are modified files elsewhere
+	const TArray<FString> CommandPaths = MakeAssetPaths(NumCommandPaths, TEXT("Asset"));
+	TArray<FString> StatusItems = MakeAssetPaths(NumStatusItems / 2, TEXT("Asset"));
+	StatusItems.Append(MakeAssetPaths(NumStatusItems - StatusItems.Num(), TEXT("Other")));
+
+	double StartTime = FPlatformTime::Seconds();
+	const FDiversionPathPrefixSet PrefixSet(CommandPaths);
+	int32 NumContained = 0;
+	for (const FString& Item : StatusItems)
+	{
+		NumContained += PrefixSet.Contains(Item) ? 1 : 0;
+	}
+	const double PrefixSetSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	int32 NumContainedLinear = 0;
+	for (int32 Index = 0; Index < NumLinearSamples; ++Index)
+	{
+		// Sampled evenly over both halves
+		NumContainedLinear += IsPathContainedLinear(StatusItems[Index * (NumStatusItems / NumLinearSamples)], CommandPaths) ? 1 : 0;
+	}
+	const double LinearSeconds = (FPlatformTime::Seconds() - StartTime) * NumStatusItems / NumLinearSamples;
+
+	UE_LOG(LogPathPrefixSetTests, Display, TEXT("Status parsing containment of %d items in %d paths: prefix set %.3f ms, linear %.1f ms (extrapolated from %d items)"),
+		NumStatusItems, NumCommandPaths, PrefixSetSeconds * 1000.0, LinearSeconds * 1000.0, NumLinearSamples);
+
+	TestEqual(TEXT("Requested items should be contained"), NumContained, NumStatusItems / 2);
+	TestEqual(TEXT("The linear lookup should agree on the sample"), NumContainedLinear, NumLinearSamples / 2);
+	return TestTrue(TEXT("The prefix set should be faster than the linear lookup"), PrefixSetSeconds < LinearSeconds);
+}
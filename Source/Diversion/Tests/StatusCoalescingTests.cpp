@@ -0,0 +1,152 @@
+// Copyright 2024 Diversion Company, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "SourceControlOperations.h"
+#include "DiversionCommand.h"
+#include "DiversionModule.h"
+#include "DiversionOperations.h"
+#include "DiversionProvider.h"
+#include "IDiversionWorker.h"
+
+namespace
+{
+	const FName UpdateStatusName = TEXT("UpdateStatus");
+	constexpr double CompletionTimeoutSeconds = 10.0;
+
+	/** The files of the status requests that actually ran */
+	struct FExecutedStatusRequests
+	{
+		FCriticalSection Lock;
+		TArray<TArray<FString>> Files;
+	};
+
+	/** Records its files and stays in flight for a while, so the following requests can be served by it */
+	class FStubStatusWorker final : public IDiversionWorker
+	{
+	public:
+		explicit FStubStatusWorker(const TSharedRef<FExecutedStatusRequests, ESPMode::ThreadSafe>& InExecuted)
+			: Executed(InExecuted) {}
+
+		virtual FName GetName() const override { return UpdateStatusName; }
+		virtual bool Execute(FDiversionCommand& InCommand) override
+		{
+			{
+				FScopeLock Lock(&Executed->Lock);
+				Executed->Files.Add(InCommand.Files);
+			}
+			FPlatformProcess::Sleep(0.3f);
+			InCommand.MarkOperationCompleted(true);
+			return true;
+		}
+		virtual bool UpdateStates() const override { return false; }
+
+	private:
+		const TSharedRef<FExecutedStatusRequests, ESPMode::ThreadSafe> Executed;
+	};
+
+	/** Replaces the status worker of the real provider for the scope of a test */
+	struct FScopedStubStatusWorker
+	{
+		const TSharedRef<FExecutedStatusRequests, ESPMode::ThreadSafe> Executed = MakeShared<FExecutedStatusRequests, ESPMode::ThreadSafe>();
+
+		FScopedStubStatusWorker()
+		{
+			FDiversionModule::Get().GetProvider().RegisterWorker(UpdateStatusName,
+				FGetDiversionWorker::CreateLambda([Executed = Executed]() -> FDiversionWorkerRef {
+					return MakeShared<FStubStatusWorker, ESPMode::ThreadSafe>(Executed);
+				}));
+		}
+		~FScopedStubStatusWorker()
+		{
+			FDiversionModule::Get().GetProvider().RegisterWorker(UpdateStatusName,
+				FGetDiversionWorker::CreateLambda([]() -> FDiversionWorkerRef {
+					return MakeShared<FDiversionUpdateStatusWorker, ESPMode::ThreadSafe>();
+				}));
+		}
+
+		/** The requests that ran for paths under InRoot - the provider might issue its own status requests meanwhile */
+		TArray<TArray<FString>> GetExecutedUnder(const FString& InRoot) const
+		{
+			FScopeLock Lock(&Executed->Lock);
+			return Executed->Files.FilterByPredicate([&InRoot](const TArray<FString>& Files) {
+				return Files.Num() > 0 && FPaths::IsUnderDirectory(Files[0], InRoot);
+			});
+		}
+	};
+
+	/** A directory nothing else requests the status of */
+	FString MakeTestRoot()
+	{
+		return FPaths::ConvertRelativePathToFull(FPaths::ProjectContentDir() / TEXT("DiversionStatusCoalescingTest"));
+	}
+
+	void ExecuteStatus(const TSharedRef<FUpdateStatus, ESPMode::ThreadSafe>& InOperation, const FString& InPath, int32& OutNumCompletions)
+	{
+		FDiversionModule::Get().GetProvider().Execute(InOperation, nullptr, { InPath }, EConcurrency::Asynchronous,
+			FSourceControlOperationComplete::CreateLambda([&OutNumCompletions](const FSourceControlOperationRef&, ECommandResult::Type) {
+				++OutNumCompletions;
+			}));
+	}
+
+	bool TickUntilCompleted(const int32& InNumCompletions, int32 InExpected)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		while (InNumCompletions < InExpected && FPlatformTime::Seconds() - StartTime < CompletionTimeoutSeconds)
+		{
+			FDiversionModule::Get().GetProvider().Tick();
+			FPlatformProcess::Sleep(0.01f);
+		}
+		return InNumCompletions == InExpected;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStatusCoalescingTestDirectoryCoversFiles, "Diversion.Tests.StatusCoalescing.DirectoryCoversFiles",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FStatusCoalescingTestDirectoryCoversFiles::RunTest(const FString& Parameters)
+{
+	FScopedStubStatusWorker StubWorker;
+	const FString Root = MakeTestRoot();
+	int32 NumCompletions = 0;
+
+	// Merged into the pending request of the directory, without adding the file to its query
+	ExecuteStatus(ISourceControlOperation::Create<FUpdateStatus>(), Root, NumCompletions);
+	ExecuteStatus(ISourceControlOperation::Create<FUpdateStatus>(), Root / TEXT("A.uasset"), NumCompletions);
+	FDiversionModule::Get().GetProvider().Tick();
+	// Served by the directory request in flight
+	ExecuteStatus(ISourceControlOperation::Create<FUpdateStatus>(), Root / TEXT("Sub/B.uasset"), NumCompletions);
+
+	TestTrue(TEXT("Every request should complete"), TickUntilCompleted(NumCompletions, 3));
+	const TArray<TArray<FString>> Executed = StubWorker.GetExecutedUnder(Root);
+	if (TestEqual(TEXT("The requests for files under a requested directory should be served by its query"), Executed.Num(), 1))
+	{
+		TestEqual(TEXT("The directory query should only hold the directory"), Executed[0], TArray<FString>({ Root }));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStatusCoalescingTestSeparateFlags, "Diversion.Tests.StatusCoalescing.SeparateFlags",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FStatusCoalescingTestSeparateFlags::RunTest(const FString& Parameters)
+{
+	FScopedStubStatusWorker StubWorker;
+	const FString Root = MakeTestRoot();
+	int32 NumCompletions = 0;
+
+	ExecuteStatus(ISourceControlOperation::Create<FUpdateStatus>(), Root, NumCompletions);
+	TSharedRef<FUpdateStatus, ESPMode::ThreadSafe> ForcedOperation = ISourceControlOperation::Create<FUpdateStatus>();
+	ForcedOperation->SetForceUpdate(true);
+	ExecuteStatus(ForcedOperation, Root, NumCompletions);
+	FDiversionModule::Get().GetProvider().Tick();
+	// Covered by the paths in flight, but asks for other data
+	TSharedRef<FUpdateStatus, ESPMode::ThreadSafe> OpenedOnlyOperation = ISourceControlOperation::Create<FUpdateStatus>();
+	OpenedOnlyOperation->SetGetOpenedOnly(true);
+	ExecuteStatus(OpenedOnlyOperation, Root / TEXT("A.uasset"), NumCompletions);
+
+	TestTrue(TEXT("Every request should complete"), TickUntilCompleted(NumCompletions, 3));
+	TestEqual(TEXT("Requests with different flags should never be merged or served by each other"), StubWorker.GetExecutedUnder(Root).Num(), 3);
+	return true;
+}
@@ -9,6 +9,7 @@
 #include <cstdio> 
 #include <string>
 #include <future>
+#include <limits>
 
 namespace beast = boost::beast;
 namespace http = beast::http;         
@@ -190,12 +191,15 @@ void FHttpSession<StreamType>::OnWrite(beast::error_code ec, std::size_t bytes_t
 	else
 	{
 		beast::error_code file_ec;
-		CompressedFilePath = FPaths::GetPath(OutputFilePath) / TEXT("compressed_response.gz");
+		// Next to the output file and named after it, concurrent downloads to the same directory don't collide
+		CompressedFilePath = OutputFilePath + TEXT(".part");
 		FileResponse.get().body().open(TCHAR_TO_UTF8(*CompressedFilePath), beast::file_mode::write, file_ec);
 		if (file_ec) {
-			response_promise.set_value(HTTPCallResponse(UTF8_TO_TCHAR(("Failed opening output file: " + ec.message()).c_str())));
+			response_promise.set_value(HTTPCallResponse(UTF8_TO_TCHAR(("Failed opening output file: " + file_ec.message()).c_str())));
 			return;
 		}
+		// The body is streamed to the file as it's received, files can be much larger than the default limit meant for in-memory bodies
+		FileResponse.body_limit(std::numeric_limits<std::uint64_t>::max());
 
 		http::async_read_header(Stream, Buffer, FileResponse, beast::bind_front_handler(&FHttpSession<StreamType>::OnReadFileResponseHeaders, this->AsShared()));
 	}
@@ -269,6 +273,8 @@ void FHttpSession<StreamType>::OnReadFileResponseBody(beast::error_code ec, std:
 
 	if (ec) {
 		LogTimeoutErrorIfExists(ec);
+		FileResponse.get().body().close();
+		std::remove(TCHAR_TO_UTF8(*CompressedFilePath));
 		response_promise.set_value(HTTPCallResponse(UTF8_TO_TCHAR(("File read error: " + ec.message()).c_str())));
 		return;
 	}
@@ -278,6 +284,7 @@ void FHttpSession<StreamType>::OnReadFileResponseBody(beast::error_code ec, std:
 	if (Compression == CompressionType::Gzip) {
 		std::string DecompressionError;
 		bool res = DecompressGzipWithZlib(TCHAR_TO_UTF8(*CompressedFilePath), TCHAR_TO_UTF8(*OutputFilePath), DecompressionError);
+		std::remove(TCHAR_TO_UTF8(*CompressedFilePath));
 		if (!res) {
 			response_promise.set_value(HTTPCallResponse(UTF8_TO_TCHAR(("Decompression error: " + DecompressionError).c_str())));
 			return;
@@ -299,7 +306,7 @@ void FHttpSession<StreamType>::OnReadFileResponseBody(beast::error_code ec, std:
 	}
 	
 	// Return the result path to the output file as a validation mechanism
-	ResponseValue = HTTPCallResponse(OutputFilePath, Response.result_int(), ExtractResponseHeaders(Response));
+	ResponseValue = HTTPCallResponse(OutputFilePath, FileResponse.get().result_int(), ExtractResponseHeaders(FileResponse.get()));
 
 	this->Shutdown();
 }